@@ -11,23 +11,44 @@ extern bool verbose;
 
 DS* DS::instance = nullptr;
 
-DS::DS(uint16_t teamNum) : teamNum(teamNum), versionFlag(ATOMIC_FLAG_INIT) {
+DS::DS(uint16_t teamNum, bool offline) : teamNum(teamNum), hadComms(false), connectUdp(false), refused(false), refusals(0), findTime(-1), versionFlag(ATOMIC_FLAG_INIT), coalesced(0), hapticTime(100, 1000), watchdog(SEND_PERIOD, 10), sendJitter(100, 200), rtt(100, 500), lossRate(0), lastLost(0), offline(offline), rtCore(-1), rtPriority(0) {
+	memset(sentSeq, 0, sizeof(sentSeq));
+	memset(sentAt, 0, sizeof(sentAt));
+	memset(&lastOutput, 0, sizeof(lastOutput));
+	for (int i = 0; i < JOYSTICK_COUNT; i++) {
+		sentEvents[i] = 0;
+		inputLatency[i].reset(new narf::Histogram(100, 1000));
+	}
 	seqNum = 1;
 	mode = Mode::TELEOP;
 	estop = false;
 	enable = false;
 	sentTime = false;
-	net.initSocketIn();
 	loadJoysticks();
-	setPosition((uint8_t)config->getInt32("DS.position"));
-	setAlliance((Alliance)config->getInt32("DS.alliance"));
-	connectFuture = std::async(std::launch::async, &Net::initSocketOut, &net, narf::util::format("roborio-%d.local", teamNum));
+	position = (uint8_t)config->getInt32("DS.position");
+	alliance = (Alliance)config->getInt32("DS.alliance");
+	watchdog.setThreshold((uint32_t)config->getInt32("DS.lossThreshold"));
+	if (!offline) {
+		net.initSocketIn();
+		net.initSocketOut();
+		resolver.init(teamNum, config->getString("DS.robotAddress"), config->getString("DS.addressCache"));
+		connectUdp = (config->getInt32("DS.connectUdp") != 0);
+		searchStart = std::chrono::steady_clock::now();
+	}
 }
 
-void DS::initialize(uint16_t teamNum) {
+void DS::initialize(uint16_t teamNum, bool offline /*= false*/) {
 	if (instance == nullptr) {
-		instance = new DS(teamNum);
+		instance = new DS(teamNum, offline);
+	}
+}
+
+bool DS::openRecorder(const std::string& filename, size_t size) {
+	if (!recorder.open(filename, size)) {
+		printf("Failed opening flight recorder %s\n", filename.c_str());
+		return false;
 	}
+	return true;
 }
 
 DS* DS::getInstance() {
@@ -35,7 +56,7 @@ DS* DS::getInstance() {
 }
 
 bool DS::isConnected() {
-	return (std::chrono::system_clock::now() - lastRecv < std::chrono::milliseconds(1000));
+	return watchdog.isUp();
 }
 
 bool DS::hasJoysticks() {
@@ -51,45 +72,85 @@ void DS::stop() {
 	running = false;
 }
 
+void DS::setRealtime(int core, int priority) {
+	rtCore = core;
+	rtPriority = priority;
+}
+
 void DS::run() {
 	running = true;
+	if (rtCore >= 0 && pinThread(rtCore)) {
+		printf("Control loop pinned to core %d\n", rtCore);
+	}
+	if (rtPriority > 0 && setRealtimePriority(rtPriority)) {
+		printf("Control loop running SCHED_FIFO priority %d\n", rtPriority);
+	}
+	// Sends are scheduled against an absolute deadline so a late wakeup
+	// doesn't push every following packet back. Incoming packets wake us
+	// up as soon as they arrive instead of waiting for the next tick.
+	auto nextSend = std::chrono::steady_clock::now();
 	while (running) {
-		auto now = std::chrono::system_clock::now();
-		std::string data = net.recv();
-		if (data.size()) {
-			if (verbose) {
-				printf("In : ");
-				for (auto &s : data) {
-					printf("%02x ", (uint8_t)s);
-				}
-				printf("\n");
-			}
-			lastRecv = now;
-			roborio.parsePacket(data);
-			for (uint8_t i = 0; i < joysticks.size(); i++) {
-				RoboRIO::Output outputs;
-				if (enable) {
-					outputs = roborio.outputs[i];
-				} else {
-					memset(&outputs, 0, sizeof(RoboRIO::Output));
-				}
-				joysticks[i]->setOutputs(outputs.outputs);
-				joysticks[i]->setRumble(outputs.rumbleLeft, outputs.rumbleRight);
+		if (net.wait(nextSend)) {
+			receive();
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now < nextSend) {
+			continue;
+		}
+
+		if (watchdog.check(now)) {
+			roborio.expire();
+		}
+		updateTarget(now);
+
+		if (lastSent.time_since_epoch().count() != 0) {
+			auto period = std::chrono::duration_cast<std::chrono::microseconds>(now - lastSent);
+			auto expected = std::chrono::duration_cast<std::chrono::microseconds>(SEND_PERIOD);
+			sendJitter.add((uint64_t)(period > expected ? period - expected : expected - period).count());
+		}
+		lastSent = now;
+		uint16_t seq = seqNum;
+		size_t outSize = makePacket(outBuf, sizeof(outBuf));
+		if (verbose) {
+			printf("Out: ");
+			for (size_t i = 0; i < outSize; i++) {
+				printf("%02x ", outBuf[i]);
 			}
+			printf("\n");
 		}
-		if (now - lastSent > std::chrono::milliseconds(20)) {
-			lastSent = now;
-			std::string outData = makePacket();
-			if (verbose) {
-				printf("Out: ");
-				for (auto &s : outData) {
-					printf("%02x ", (uint8_t)s);
+		sentSeq[seq % RTT_SLOTS] = seq;
+		sentAt[seq % RTT_SLOTS] = net.now();
+		if (hadComms) {
+			if (net.send(outBuf, outSize) < 0 && errno == ECONNREFUSED) {
+				// Only a connected socket hears about this, and it means the
+				// roboRIO is up but nothing is on port 1110. No point waiting
+				// out the timeout for status that isn't coming.
+				printf("No robot code listening at %s\n", net.getTarget().toString().c_str());
+				refused = true;
+				refusals++;
+				if (watchdog.trip(now)) {
+					roborio.expire();
 				}
-				printf("\n");
 			}
-			net.send(outData);
+		} else {
+			net.sendAll(outBuf, outSize, raceAddrs.data(), raceAddrs.size());
+		}
+		record(TO_ROBOT, outBuf, outSize);
+
+		if (now - lastLossCheck >= std::chrono::seconds(1)) {
+			uint64_t lost = echoes.lost();
+			lossRate = (uint32_t)(lost > lastLost ? lost - lastLost : 0);
+			lastLost = lost;
+			lastLossCheck = now;
 		}
-		if ((libraryVer.size() == 0 || firmwareVer.size() == 0) && (now - lastVersionCheck > std::chrono::milliseconds(2000))) {
+
+		// Skip any slots we slept through, but stay on the original phase
+		do {
+			nextSend += SEND_PERIOD;
+		} while (nextSend <= now);
+
+		if ((libraryVer.size() == 0 || firmwareVer.size() == 0) && (std::chrono::system_clock::now() - lastVersionCheck > std::chrono::milliseconds(2000))) {
 			if (!versionFlag.test_and_set()) {
 				versionFuture = std::async(std::launch::async, &DS::loadVersions, this);
 			}
@@ -100,15 +161,249 @@ void DS::run() {
 			estop = false;
 			enable = false;
 		}
+	}
+}
+
+void DS::updateTarget(std::chrono::steady_clock::time_point now) {
+	if (isConnected()) {
+		return;
+	}
+	bool lost = hadComms;
+	if (hadComms) {
+		hadComms = false;
+		printf("Looking for the roboRIO again\n");
+		net.disconnect();
+		searchStart = now;
+		resolver.refresh(); // It may be somewhere else now, e.g. after a radio reboot
+	}
+	if (resolver.update() || lost || raceAddrs.empty()) {
+		// Where it last answered from goes first, as it's most likely still
+		// there. The rest keep their last known addresses while they're
+		// looked up again, so the race never stops.
+		raceAddrs.clear();
+		auto add = [&](const narf::net::Address& addr) {
+			if (addr.family() == AF_UNSPEC || raceAddrs.size() >= SEND_FANOUT) {
+				return;
+			}
+			for (auto& a : raceAddrs) {
+				if (a.sameHost(addr)) {
+					return;
+				}
+			}
+			raceAddrs.push_back(addr);
+		};
+		add(net.getTarget());
+		for (auto& c : resolver.getCandidates()) {
+			if (!c.resolved) {
+				continue;
+			}
+			for (auto& addr : c.addrs) {
+				add(addr);
+			}
+		}
+	}
+}
 
-		SDL_JoystickUpdate();
+void DS::lockTarget(const narf::net::Address& from) {
+	// Replies come from port 1110's host but not that port, so only the address carries over
+	narf::net::Address addr = from;
+	addr.setPort(1110);
+	const char* source = "answered";
+	for (auto& c : resolver.getCandidates()) {
+		auto match = std::find_if(c.addrs.begin(), c.addrs.end(), [&](const narf::net::Address& a) { return a.sameHost(addr); });
+		if (c.resolved && match != c.addrs.end()) {
+			source = c.source;
+			break;
+		}
+	}
+	net.setTarget(addr);
+	if (connectUdp) {
+		net.connect(from);
+	}
+	refused = false;
+	std::string host = addr.toString();
+	auto& info = targetInfo.back();
+	snprintf(info.host, sizeof(info.host), "%s", host.c_str());
+	info.source = source;
+	targetInfo.publish();
+	hadComms = true;
+	findTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - searchStart).count();
+	printf("Comms up with roboRIO at %s (%s) after %lld ms\n", host.c_str(), source, (long long)findTime);
+	resolver.remember(addr);
+}
+
+std::string DS::getTargetText() {
+	targetInfo.update();
+	auto& info = targetInfo.front();
+	if (info.host[0] == '\0') {
+		return "nowhere yet";
+	}
+	return narf::util::format("%s (%s)", info.host, info.source);
+}
+
+void DS::receive() {
+	// Drain everything that's queued, but only act on the newest status.
+	// If we fell behind, the older ones are already stale.
+	uint64_t count = 0;
+	size_t n;
+	do {
+		n = net.recvBatch();
+		for (size_t i = 0; i < n; i++) {
+			auto& d = net.getDatagram(i);
+			record(FROM_ROBOT, d.data, d.size);
+			if (d.size < 8) {
+				continue;
+			}
+			if (verbose) {
+				printf("In : ");
+				for (size_t j = 0; j < d.size; j++) {
+					printf("%02x ", d.data[j]);
+				}
+				printf("\n");
+			}
+			if (!hadComms && !offline) {
+				lockTarget(d.from);
+			}
+			uint16_t seq = (uint16_t)((d.data[0] << 8) | d.data[1]);
+			recordRTT(seq, d.stamp);
+			echoes.add(seq);
+			// latest only holds a datagram once one has been copied into it
+			if (count == 0 || RoboRIO::seqNewer(seq, (uint16_t)((latest.data[0] << 8) | latest.data[1]))) {
+				memcpy(latest.data, d.data, d.size);
+				latest.size = d.size;
+			}
+			count++;
+		}
+	} while (n == RECV_BATCH);
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(15));
+	if (count == 0) {
+		return;
 	}
+	coalesced += count - 1;
+	handleStatus(latest.data, latest.size);
 }
 
-std::string DS::makePacket() {
-	narf::ByteStream s;
+void DS::handleStatus(const uint8_t* data, size_t size) {
+	watchdog.feed(std::chrono::steady_clock::now());
+	roborio.parsePacket(data, size);
+	OutputSnapshot out;
+	memset(&out, 0, sizeof(out));
+	if (enable) {
+		memcpy(out.sticks, roborio.outputs, sizeof(out.sticks));
+	}
+	if (memcmp(&out, &lastOutput, sizeof(out)) != 0) {
+		lastOutput = out;
+		output.back() = out;
+		output.publish();
+	}
+}
+
+void DS::record(Direction dir, const void* data, size_t size) {
+	if (recorder.isOpen()) {
+		// Wall clock: the ring keeps earlier runs, and steady_clock starts over
+		// at every boot, which would put new records before old ones
+		auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+		recorder.append((uint8_t)dir, (uint64_t)now.count(), data, (uint32_t)size);
+	}
+}
+
+bool DS::replay(const std::string& filename, double speed) {
+	narf::RingFile rf;
+	if (!rf.openReadOnly(filename)) {
+		printf("Couldn't open recording %s\n", filename.c_str());
+		return false;
+	}
+	running = true;
+
+	size_t in = 0, out = 0, mismatched = 0;
+	uint64_t prev = 0;
+	int64_t elapsed = 0; // Recording time played so far, in ns
+	const int64_t maxGap = std::chrono::duration_cast<std::chrono::nanoseconds>(RECORD_MAX_GAP).count();
+	std::chrono::nanoseconds busy(0);
+	auto start = std::chrono::steady_clock::now();
+	rf.forEach([&](const narf::RingFile::Record& r) {
+		if (!running) {
+			return;
+		}
+		if (in + out > 0) {
+			// Stamps from different runs can go backwards (clock set back, or
+			// an older recording) or jump ahead, so step in signed and clamp
+			int64_t step = (int64_t)(r.stamp - prev);
+			elapsed += std::max((int64_t)0, std::min(step, maxGap));
+		}
+		prev = r.stamp;
+		if (speed > 0) {
+			std::this_thread::sleep_until(start + std::chrono::nanoseconds((int64_t)((double)elapsed / speed)));
+		}
+		auto t = std::chrono::steady_clock::now();
+		if (r.type == FROM_ROBOT) {
+			if (r.size >= 8) {
+				echoes.add((uint16_t)((r.data[0] << 8) | r.data[1]));
+				handleStatus(r.data, r.size);
+			}
+			in++;
+		} else if (r.type == TO_ROBOT) {
+			if (!replayControl(r.data, r.size)) {
+				mismatched++;
+			}
+			out++;
+		}
+		busy += std::chrono::steady_clock::now() - t;
+	});
+
+	double secs = std::chrono::duration_cast<std::chrono::duration<double>>(busy).count();
+	printf("Replayed %zu packets (%zu in, %zu out) from %s\n", in + out, in, out, filename.c_str());
+	printf("Parse/encode: %.3f s, %.0f packets/s\n", secs, secs > 0 ? (double)(in + out) / secs : 0.0);
+	printf("Lost: %llu  Late: %llu  Duplicates: %llu\n", (unsigned long long)echoes.lost(),
+			(unsigned long long)echoes.late(), (unsigned long long)echoes.duplicates());
+	if (mismatched) {
+		printf("%zu control packets didn't re-encode to the recorded header\n", mismatched);
+	}
+	return mismatched == 0;
+}
+
+bool DS::replayControl(const uint8_t* data, size_t size) {
+	// Put the DS into the state the recorded packet was sent from, encode
+	// it again and check the header comes out the same. Joystick blocks
+	// aren't compared since there are no devices to rebuild them from.
+	if (size < 6) {
+		return false;
+	}
+	seqNum = (uint16_t)((data[0] << 8) | data[1]);
+	estop = (data[3] & (1 << 7)) != 0;
+	enable = (data[3] & (1 << 2)) != 0;
+	mode = (Mode)(data[3] & 0x03);
+	auto now = std::chrono::system_clock::now();
+	rebooting = (data[4] & (1 << 3)) ? now + std::chrono::milliseconds(500) : std::chrono::system_clock::time_point();
+	restartingCode = (data[4] & (1 << 2)) ? now + std::chrono::milliseconds(500) : std::chrono::system_clock::time_point();
+	alliance = (data[5] >= 3) ? Alliance::BLUE : Alliance::RED;
+	position = (uint8_t)(data[5] % 3 + 1);
+	bool hasTime = (size > 7 && data[7] == 0x0f);
+	sentTime = !hasTime;
+
+	size_t outSize = makePacket(outBuf, sizeof(outBuf));
+	if (outSize < 6 || memcmp(outBuf, data, 6) != 0) {
+		return false;
+	}
+	return !hasTime || (outSize > 7 && outBuf[7] == 0x0f);
+}
+
+void DS::recordRTT(uint16_t seq, int64_t stamp) {
+	// The roboRIO echoes our seqNum, so match it against when we sent it.
+	// Slots are cleared once used so a duplicate doesn't count twice.
+	size_t slot = seq % RTT_SLOTS;
+	if (sentSeq[slot] != seq || sentAt[slot] == 0) {
+		return;
+	}
+	int64_t us = (stamp - sentAt[slot]) / 1000;
+	sentAt[slot] = 0;
+	if (us >= 0) { // Wall clock stamps can step backwards
+		rtt.add((uint64_t)us);
+	}
+}
+
+size_t DS::makePacket(uint8_t* buf, size_t size) {
+	narf::ByteWriter s(buf, size);
 	s.write(seqNum, BE);
 	s.write((uint8_t)0x01);
 	s.write((uint8_t)((estop ? (1 << 7) : 0) | (enable ? (1 << 2) : 0) | mode));
@@ -120,46 +415,100 @@ std::string DS::makePacket() {
 
 	seqNum++;
 
-	std::string out = s.str();
 	if (!sentTime) {
 		sentTime = true;
-		out += timePacket();
+		timePacket(s);
 	} else {
-		if (jsMutex.try_lock()) {
-			for (auto& js : joysticks) {
-				out += js->makePacket();
+		input.update();
+		auto& in = input.front();
+		int64_t sendNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		for (uint8_t i = 0; i < in.count; i++) {
+			auto& st = in.sticks[i];
+			Joystick::makePacket(st, s);
+			if (st.events != sentEvents[i].load(std::memory_order_relaxed)) {
+				if (st.pendingSince != 0 && sendNs >= st.pendingSince) {
+					inputLatency[i]->add((uint64_t)(sendNs - st.pendingSince) / 1000);
+				}
+				sentEvents[i].store(st.events, std::memory_order_relaxed);
 			}
-			jsMutex.unlock();
 		}
 	}
 
-	return out;
+	return s.size();
 }
 
 void DS::updateJoysticks() {
-	if (jsMutex.try_lock()) {
-		for (auto js : joysticks) {
-			js->update();
+	output.update();
+	auto& out = output.front();
+	bool connected = isConnected(); // Don't keep rumbling after the robot goes away
+	jsMutex.lock();
+	for (size_t i = 0; i < joysticks.size() && i < JOYSTICK_COUNT; i++) {
+		auto& o = out.sticks[i];
+		joysticks[i]->setOutputs(connected ? o.outputs : 0);
+		joysticks[i]->setRumble(connected ? o.rumbleLeft : 0, connected ? o.rumbleRight : 0);
+		joysticks[i]->update(hapticTime);
+	}
+	jsMutex.unlock();
+}
+
+void DS::handleInput(const SDL_Event& e) {
+	SDL_JoystickID which;
+	Uint32 stamp;
+	switch (e.type) {
+		case SDL_JOYAXISMOTION: which = e.jaxis.which; stamp = e.jaxis.timestamp; break;
+		case SDL_JOYHATMOTION: which = e.jhat.which; stamp = e.jhat.timestamp; break;
+		case SDL_JOYBUTTONDOWN:
+		case SDL_JOYBUTTONUP: which = e.jbutton.which; stamp = e.jbutton.timestamp; break;
+		default: return;
+	}
+	// SDL stamps events in milliseconds when they're queued, so take off how long it sat there
+	auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t at = now - (int64_t)(SDL_GetTicks() - stamp) * 1000000;
+	jsMutex.lock();
+	for (size_t i = 0; i < joysticks.size() && i < JOYSTICK_COUNT; i++) {
+		if (joysticks[i]->getInstanceID() == which) {
+			if (joysticks[i]->handleEvent(e, at, sentEvents[i].load(std::memory_order_relaxed))) {
+				publishInput();
+			}
+			break;
 		}
-		jsMutex.unlock();
 	}
+	jsMutex.unlock();
+}
+
+void DS::publishInput() {
+	auto& snap = input.back();
+	snap.count = (uint8_t)std::min(joysticks.size(), (size_t)JOYSTICK_COUNT);
+	for (uint8_t i = 0; i < snap.count; i++) {
+		snap.sticks[i] = joysticks[i]->getState();
+	}
+	input.publish();
 }
 
 void DS::loadJoysticks() {
+	if (offline) {
+		if (joysticks.empty()) {
+			for (int i = 0; i < JOYSTICK_COUNT; i++) {
+				joysticks.push_back(new Joystick());
+			}
+			publishInput();
+		}
+		return;
+	}
 	jsMutex.lock();
 	//printf("Unloading %ld joysticks\n", joysticks.size());
 	joysticks.clear();
 	//joysticks.resize(6);
 	printf("Loading %d joystick%s\n", SDL_NumJoysticks(), SDL_NumJoysticks() != 1 ? "s" : "");
 	std::vector<int> loadedIndexes;
-	for (int i = 0; i < 6; i++) {
+	for (int i = 0; i < JOYSTICK_COUNT; i++) {
 		auto guid = config->getString(narf::util::format("DS.joystick.%d", i));
 		joysticks.push_back(new Joystick(guid));
 		loadedIndexes.push_back(joysticks[i]->getDeviceIdx());
 	}
 	for (int i = 0; i < SDL_NumJoysticks(); i++) {
 		if (std::count(loadedIndexes.begin(), loadedIndexes.end(), i) == 0) {
-			for (int j = 0; j < 6; j++) {
+			for (int j = 0; j < JOYSTICK_COUNT; j++) {
 				if (joysticks[j]->getGUID() == "") { // Find first empty index
 					delete joysticks[j];
 					joysticks[j] = new Joystick(i);
@@ -168,13 +517,17 @@ void DS::loadJoysticks() {
 			}
 		}
 	}
+	publishInput();
 	jsMutex.unlock();
 	saveJoysticks();
 }
 
 void DS::saveJoysticks() {
+	if (offline) {
+		return;
+	}
 	jsMutex.lock();
-	for (int i = 0; i < 6; i++) {
+	for (int i = 0; i < JOYSTICK_COUNT; i++) {
 		config->setString(narf::util::format("DS.joystick.%d", i), joysticks[i]->getGUID());
 	}
 	config->saveFile();
@@ -185,6 +538,9 @@ void DS::swapJoysticks(uint8_t a, uint8_t b) {
 	enable = false;
 	jsMutex.lock();
 	std::swap(joysticks[a], joysticks[b]);
+	joysticks[a]->clearPending(); // sentEvents belonged to the other one
+	joysticks[b]->clearPending();
+	publishInput();
 	jsMutex.unlock();
 	saveJoysticks();
 }
@@ -236,6 +592,7 @@ bool DS::getEnable() {
 }
 
 void DS::loadVersions() {
+	leaveRealtime(); // Started from the control loop, so it inherited its core and priority
 	lastVersionCheck = std::chrono::system_clock::now();
 	libraryVer = curlLibVersion(teamNum);
 	firmwareVer = curlFirmwareVersion(teamNum);
@@ -250,7 +607,7 @@ std::string DS::getFirmwareVersion() {
 	return firmwareVer;
 }
 
-std::string DS::timePacket() {
+void DS::timePacket(narf::ByteWriter& out) {
 	auto now = std::chrono::system_clock::now();
 	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
 	auto s = std::chrono::duration_cast<std::chrono::seconds>(ms);
@@ -258,25 +615,94 @@ std::string DS::timePacket() {
 	std::tm* t = std::gmtime(&epoch);
 	uint32_t t_ms = (uint32_t)(ms.count() % 1000);
 
-	char tzbuf[32];
-	std::strftime(tzbuf, 32, "%Z", std::localtime(&epoch));
-	std::string tz(tzbuf);
-
-	narf::ByteStream bs;
-	bs.write((uint8_t)11);
-	bs.write((uint8_t)0x0f);
-	bs.write((uint32_t)t_ms);
-	bs.write((uint8_t)t->tm_sec);
-	bs.write((uint8_t)t->tm_min);
-	bs.write((uint8_t)t->tm_hour);
-	bs.write((uint8_t)t->tm_mday);
-	bs.write((uint8_t)t->tm_mon);
-	bs.write((uint8_t)t->tm_year);
-	bs.write((uint8_t)(tz.size() + 1));
-	bs.write((uint8_t)0x10);
-	bs.write(tz);
+	char tz[32];
+	size_t tzLen = std::strftime(tz, sizeof(tz), "%Z", std::localtime(&epoch));
+
+	out.write((uint8_t)11);
+	out.write((uint8_t)0x0f);
+	out.write((uint32_t)t_ms);
+	out.write((uint8_t)t->tm_sec);
+	out.write((uint8_t)t->tm_min);
+	out.write((uint8_t)t->tm_hour);
+	out.write((uint8_t)t->tm_mday);
+	out.write((uint8_t)t->tm_mon);
+	out.write((uint8_t)t->tm_year);
+	out.write((uint8_t)(tzLen + 1));
+	out.write((uint8_t)0x10);
+	out.write(tz, tzLen);
 	if (verbose) {
-		printf("Sending time packet. TZ: %s\n", tz.c_str());
+		printf("Sending time packet. TZ: %s\n", tz);
+	}
+}
+
+static std::string histogramStats(const std::string& section, const narf::Histogram& h) {
+	std::string s = narf::util::format("[%s]\n", section.c_str());
+	s += narf::util::format("\tcount = %llu\n", (unsigned long long)h.count());
+	s += narf::util::format("\tmin = %llu\n", (unsigned long long)h.min());
+	s += narf::util::format("\tavg = %.1f\n", h.mean());
+	s += narf::util::format("\tp50 = %llu\n", (unsigned long long)h.percentile(50));
+	s += narf::util::format("\tp90 = %llu\n", (unsigned long long)h.percentile(90));
+	s += narf::util::format("\tp99 = %llu\n", (unsigned long long)h.percentile(99));
+	s += narf::util::format("\tmax = %llu\n", (unsigned long long)h.max());
+	s += narf::util::format("[%s.buckets]\n", section.c_str());
+	for (size_t i = 0; i < h.bucketCount(); i++) {
+		if (h.bucket(i)) { // Keyed by the bucket's lower bound
+			s += narf::util::format("\t%llu = %llu\n", (unsigned long long)(i * h.bucketWidth()), (unsigned long long)h.bucket(i));
+		}
+	}
+	return s;
+}
+
+bool DS::dumpStats() {
+	auto filename = config->getString("DS.statsFile");
+	std::string s = narf::util::format("; SimpleDS stats for team %d, times in microseconds, bursts in packets\n", teamNum);
+	s += narf::util::format("[Net]\n\ttimestamps = %s\n", net.hasKernelStamps() ? "kernel" : "userspace");
+	s += narf::util::format("\tcoalesced = %llu\n", (unsigned long long)coalesced);
+	s += narf::util::format("\trobot = %s\n", getTargetText().c_str());
+	s += narf::util::format("\tfindTime = %lld\n", (long long)findTime);
+	s += narf::util::format("\tconnected = %s\n", net.isConnected() ? "yes" : "no");
+	s += narf::util::format("\trefusals = %u\n", (unsigned)refusals);
+	s += "[Watchdog]\n";
+	s += narf::util::format("\tthreshold = %u\n", (unsigned)watchdog.getThreshold());
+	s += narf::util::format("\tlosses = %u\n", (unsigned)watchdog.getLosses());
+	s += narf::util::format("\tlongestOutage = %lld\n", (long long)watchdog.getLongestOutage());
+	s += "[Watchdog.events]\n"; // Times in ms: up before a loss, out before coming back
+	for (auto& e : watchdog.getEvents()) {
+		std::time_t t = std::chrono::system_clock::to_time_t(e.at);
+		char when[32];
+		std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+		if (e.lost) {
+			s += narf::util::format("\t%s = lost, %lld up, %u missed\n", when, (long long)e.duration, (unsigned)e.missed);
+		} else {
+			s += narf::util::format("\t%s = up, %lld out\n", when, (long long)e.duration);
+		}
+	}
+	s += "[Loss]\n";
+	s += narf::util::format("\treceived = %llu\n", (unsigned long long)echoes.received());
+	s += narf::util::format("\tlost = %llu\n", (unsigned long long)echoes.lost());
+	s += narf::util::format("\tlate = %llu\n", (unsigned long long)echoes.late());
+	s += narf::util::format("\tduplicates = %llu\n", (unsigned long long)echoes.duplicates());
+	s += narf::util::format("\tstale = %llu\n", (unsigned long long)echoes.stale());
+	s += narf::util::format("\twraps = %llu\n", (unsigned long long)echoes.wraps());
+	s += narf::util::format("\tlastSecond = %u\n", (unsigned)lossRate);
+	s += histogramStats("LossBursts", echoes.bursts());
+	s += histogramStats("RTT", rtt);
+	s += histogramStats("SendJitter", sendJitter);
+	s += histogramStats("Haptic", hapticTime);
+	for (size_t i = 0; i < JOYSTICK_COUNT; i++) {
+		if (inputLatency[i]->count() > 0) {
+			std::string name = i < joysticks.size() ? joysticks[i]->getName() : "";
+			s += narf::util::format("; Joystick %zu: %s\n", i, name.c_str());
+			s += histogramStats(narf::util::format("InputLatency.%zu", i), *inputLatency[i]);
+		}
+	}
+
+	narf::MemoryFile file;
+	file.setData(s);
+	if (!file.write(filename)) {
+		printf("Failed writing stats to %s\n", filename.c_str());
+		return false;
 	}
-	return bs.str();
+	printf("Wrote stats to %s\n", filename.c_str());
+	return true;
 }
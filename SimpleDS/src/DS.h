@@ -12,19 +12,35 @@
 #include "RoboRIO.h"
 #include "joystick.h"
 #include "rioversions.h"
+#include "realtime.h"
+#include "resolver.h"
+#include "watchdog.h"
 #include "narf/format.h"
 #include "narf/tokenize.h"
-#include "narf/bytestream.h"
+#include "narf/bytewriter.h"
+#include "narf/histogram.h"
+#include "narf/ringfile.h"
+#include "narf/seqtracker.h"
+#include "narf/triplebuffer.h"
 
 #include <map>
 #include <ctime>
 #include <atomic>
 #include <chrono>
 #include <future>
+#include <memory>
 #include <string>
+#include <thread>
 #include <algorithm>
+#include <cerrno>
 #include <SDL2/SDL.h>
 
+#define SEND_PERIOD std::chrono::milliseconds(20)
+#define RECORD_MAX_GAP std::chrono::seconds(1) // Longer pauses between recorded packets are breaks between runs
+#define RTT_SLOTS 256 // Outstanding send times kept for matching echoed seqNums
+#define JOYSTICK_COUNT 6
+static_assert(6 + JOYSTICK_COUNT * JS_BLOCK_MAX <= BUFSIZE, "Control packet with every joystick maxed out has to fit in outBuf");
+
 extern Config* config;
 
 class DS {
@@ -39,7 +55,23 @@ class DS {
 		bool enable;
 
 		bool sentTime;
-		std::future<bool> connectFuture;
+
+		// Control loop only, except the atomics which are for display.
+		// Until the roboRIO answers, packets go to every address it might
+		// be at, and whichever answers first is where they go from then on.
+		Resolver resolver;
+		std::vector<narf::net::Address> raceAddrs;
+		std::chrono::steady_clock::time_point searchStart;
+		bool hadComms;
+		struct TargetInfo {
+			char host[INET6_ADDRSTRLEN + IF_NAMESIZE + 1]; // With %interface for link-local, "" before the first answer
+			const char* source;
+		};
+		narf::TripleBuffer<TargetInfo> targetInfo; // Read on the main thread
+		bool connectUdp; // connect() the sockets once the roboRIO answers, see Net::connect()
+		std::atomic_bool refused; // It sent back port unreachable, and hasn't answered since
+		std::atomic<uint32_t> refusals;
+		std::atomic<int64_t> findTime; // ms from starting to look to the first answer, -1 before that
 
 		std::atomic_bool running;
 
@@ -49,33 +81,85 @@ class DS {
 		std::future<void> versionFuture;
 		std::atomic_flag versionFlag;
 
+		uint8_t outBuf[BUFSIZE];
+		Datagram latest;
+		std::atomic<uint64_t> coalesced; // Stale status packets dropped in favor of a newer one
+
 		Net net;
+		narf::RingFile recorder; // Every packet both ways, see record()
 		RoboRIO roborio;
 		std::vector<Joystick*> joysticks;
-		std::mutex jsMutex;
+		std::mutex jsMutex; // Held by the input thread while it changes which Joystick is where
 
-		std::chrono::system_clock::time_point lastSent;
-		std::chrono::system_clock::time_point lastRecv;
+		// Every joystick as of the last input event. Published by the input
+		// thread and read by makePacket() without either waiting.
+		struct InputSnapshot {
+			uint8_t count;
+			Joystick::State sticks[JOYSTICK_COUNT];
+		};
+		narf::TripleBuffer<InputSnapshot> input;
+		// What the roboRIO wants each joystick's outputs and rumble set to.
+		// Published by the control loop when it changes, applied by updateJoysticks().
+		struct OutputSnapshot {
+			RoboRIO::Output sticks[JOYSTICK_COUNT];
+		};
+		static_assert(sizeof(OutputSnapshot::sticks) == sizeof(RoboRIO::outputs), "One output per joystick slot");
+		narf::TripleBuffer<OutputSnapshot> output;
+		OutputSnapshot lastOutput; // Control loop only
+		narf::Histogram hapticTime; // Spent in SDL_HapticUpdateEffect, in microseconds
+		std::atomic<uint32_t> sentEvents[JOYSTICK_COUNT]; // State::events as of the last packet, per slot
+		std::unique_ptr<narf::Histogram> inputLatency[JOYSTICK_COUNT]; // Input event to the packet carrying it, in microseconds
+
+		std::chrono::steady_clock::time_point lastSent;
+		Watchdog watchdog; // Decides isConnected()
+		narf::Histogram sendJitter; // |actual send period - SEND_PERIOD| in microseconds
+		narf::Histogram rtt; // Send to echoed status, in microseconds
+		uint16_t sentSeq[RTT_SLOTS];
+		int64_t sentAt[RTT_SLOTS]; // Net::now() at send, 0 once matched
+		narf::SeqTracker echoes; // Echoed seqNums; a gap is a lost trip either way
+		std::atomic<uint32_t> lossRate; // Lost over the last second
+		uint64_t lastLost;
+		std::chrono::steady_clock::time_point lastLossCheck;
 		std::chrono::system_clock::time_point rebooting;
 		std::chrono::system_clock::time_point restartingCode;
 
-		DS(uint16_t teamNum); // : teamNum(teamNum), seqNum(1)
+		bool offline; // Replaying: no sockets, devices or config writes
+		int rtCore; // Core the control loop is pinned to, -1 if it isn't
+		int rtPriority; // SCHED_FIFO priority for the control loop, 0 for normal
+
+		DS(uint16_t teamNum, bool offline); // : teamNum(teamNum), seqNum(1)
 		void initInSocket();
 		bool initOutSocket();
 		void disconnect();
-		void parsePacket(char* data, uint16_t size);
-		std::string makePacket();
+		// Keeps the list of addresses to race up to date while there are no comms
+		void updateTarget(std::chrono::steady_clock::time_point now);
+		void lockTarget(const narf::net::Address& from);
+		void receive();
+		void handleStatus(const uint8_t* data, size_t size);
+		bool replayControl(const uint8_t* data, size_t size);
+		void recordRTT(uint16_t seq, int64_t stamp);
+		void record(Direction dir, const void* data, size_t size);
+		size_t makePacket(uint8_t* buf, size_t size);
 		void loadVersions();
+		void publishInput();
 		static DS* instance;
 
 	public:
-		static void initialize(uint16_t teamNum);
+		static void initialize(uint16_t teamNum, bool offline = false);
 		static DS* getInstance();
 		bool isConnected();
 		bool hasJoysticks();
 		void stop();
+		// Applied by run() to its own thread, and undone for the helper threads it starts
+		void setRealtime(int core, int priority);
 		void run();
-		void updateJoysticks();
+		// Feed a flight recording through the parsers and encoder instead of
+		// the network. speed is a multiple of real time; 0 goes flat out.
+		bool replay(const std::string& filename, double speed);
+		bool openRecorder(const std::string& filename, size_t size);
+		void updateJoysticks(); // Outputs and rumble; input arrives through handleInput()
+		// Joystick axis, button and hat events, from the thread polling SDL events
+		void handleInput(const SDL_Event& e);
 		void loadJoysticks();
 		void saveJoysticks();
 		void swapJoysticks(uint8_t a, uint8_t b);
@@ -95,7 +179,20 @@ class DS {
 		std::string getFirmwareVersion();
 		RoboRIO* getRoboRIO() { return &roborio; }
 		std::vector<Joystick*> getJoysticks() { return joysticks; }
-		std::string timePacket();
+		void timePacket(narf::ByteWriter& out);
+		const narf::Histogram& getSendJitter() { return sendJitter; }
+		uint64_t getCoalesced() { return coalesced; }
+		const narf::Histogram& getRTT() { return rtt; }
+		const narf::Histogram& getInputLatency(size_t slot) { return *inputLatency[slot]; }
+		const narf::Histogram& getHapticTime() { return hapticTime; }
+		bool hasKernelStamps() { return net.hasKernelStamps(); }
+		std::string getTargetText();
+		int64_t getFindTime() { return findTime; }
+		bool wasRefused() { return refused; }
+		Watchdog& getWatchdog() { return watchdog; }
+		const narf::SeqTracker& getEchoes() { return echoes; }
+		uint32_t getLossRate() { return lossRate; }
+		bool dumpStats();
 };
 
 #endif /* _DS_H_ */
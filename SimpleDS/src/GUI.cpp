@@ -5,10 +5,16 @@
 /*----------------------------------------------------------------------------*/
 
 #include "GUI.h"
+#include <algorithm>
 
 #define FONTSIZE 12
 #define WINHEIGHT 160
 #define WINWIDTH 640
+#define GLYPH_FIRST ' '
+#define GLYPH_LAST '~'
+#define ATLAS_COLUMNS 16
+#define FRAME_BUCKET_US 50
+#define FRAME_BUCKETS 400
 
 const SDL_Color Colors::BLACK = {0, 0, 0};
 const SDL_Color Colors::WHITE = {255, 255, 255};
@@ -18,7 +24,9 @@ const SDL_Color Colors::DISABLED = {140, 140, 140};
 
 DECLARE_EMBED(DroidSansMono_ttf)
 
-GUI::GUI() {
+GUI::GUI() : win(nullptr), font(nullptr), renderer(nullptr), layer(0), target(nullptr), fullRedraw(true),
+	framesDrawn(0), framesSkipped(0), atlas(nullptr),
+	frameTimes(FRAME_BUCKET_US, FRAME_BUCKETS), lastFrameTime(0) {
 	cursor.x = cursor.y = 0;
 	offset.x = 10;
 	offset.y = 10;
@@ -65,14 +73,82 @@ GUI::GUI() {
 		return;
 	}
 
+	if (!buildAtlas()) {
+		return;
+	}
+
+	if (SDL_RenderTargetSupported(renderer)) {
+		target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, WINWIDTH, WINHEIGHT);
+	}
+	if (!target) {
+		printf("Render targets not supported, will redraw whole frames\n");
+	}
+	setOffset(offset.x, offset.y);
+
 	SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
 	valid = true;
 }
 
 GUI::~GUI() {
+	if (target) {
+		SDL_DestroyTexture(target);
+	}
+	if (atlas) {
+		SDL_DestroyTexture(atlas);
+	}
 	SDL_DestroyWindow(win);
 }
 
+// Render every printable character once, in white, into one texture. Text is
+// then drawn by copying out of it with the color applied at draw time,
+// instead of rendering and uploading each glyph again every frame.
+bool GUI::buildAtlas() {
+	const int count = GLYPH_LAST - GLYPH_FIRST + 1;
+	const SDL_Color white = {255, 255, 255, 255};
+	std::vector<SDL_Surface*> surfaces(count, nullptr);
+	Point cell = {1, 1};
+	for (int i = 0; i < count; i++) {
+		surfaces[i] = TTF_RenderGlyph_Blended(font, (Uint16)(GLYPH_FIRST + i), white);
+		if (surfaces[i]) {
+			cell.x = std::max(cell.x, surfaces[i]->w);
+			cell.y = std::max(cell.y, surfaces[i]->h);
+		}
+	}
+
+	int rows = (count + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+	SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, cell.x * ATLAS_COLUMNS, cell.y * rows, 32, SDL_PIXELFORMAT_RGBA32);
+	if (!sheet) {
+		printf("Error: Failed to create glyph atlas: %s\n", SDL_GetError());
+	}
+	for (int i = 0; i < count; i++) {
+		Glyph& g = glyphs[i];
+		g.src = {(i % ATLAS_COLUMNS) * cell.x, (i / ATLAS_COLUMNS) * cell.y, 0, 0};
+		TTF_GlyphMetrics(font, (Uint16)(GLYPH_FIRST + i), &g.minX, NULL, NULL, NULL, NULL);
+		if (surfaces[i]) {
+			g.src.w = surfaces[i]->w;
+			g.src.h = surfaces[i]->h;
+			if (sheet) {
+				// Copy the alpha as-is rather than blending it onto the empty sheet
+				SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+				SDL_BlitSurface(surfaces[i], NULL, sheet, &g.src);
+			}
+			SDL_FreeSurface(surfaces[i]);
+		}
+	}
+	if (!sheet) {
+		return false;
+	}
+
+	atlas = SDL_CreateTextureFromSurface(renderer, sheet);
+	SDL_FreeSurface(sheet);
+	if (!atlas) {
+		printf("Error: Failed to create glyph atlas texture: %s\n", SDL_GetError());
+		return false;
+	}
+	SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+	return true;
+}
+
 void GUI::SetTitle(std::string str) {
 	std::string newTitle = "SimpleDS";
 	if (str.size()) {
@@ -95,11 +171,152 @@ bool GUI::isValid() {
 }
 
 void GUI::clear() {
-	SDL_RenderClear(renderer);
+	frameStart = std::chrono::steady_clock::now();
+	const Cell blank = {' ', 0, 0, 0};
+	for (auto& l : layers) {
+		std::fill(l.back.begin(), l.back.end(), blank);
+	}
 }
 
 void GUI::render() {
+	bool changed = fullRedraw;
+	for (size_t i = 0; i < layers.size() && !changed; i++) {
+		changed = memcmp(layers[i].front.data(), layers[i].back.data(), layers[i].back.size() * sizeof(Cell)) != 0;
+	}
+	if (!changed) {
+		// Same as what's on screen, so don't touch the GPU at all
+		framesSkipped++;
+		return;
+	}
+
+	if (target) {
+		SDL_SetRenderTarget(renderer, target);
+	}
+	if (fullRedraw || !target) {
+		SDL_RenderClear(renderer);
+		for (auto& l : layers) {
+			for (int y = 0; y < l.rows; y++) {
+				for (int x = 0; x < l.cols; x++) {
+					queueChar(l, x, y, l.back[y * l.cols + x]);
+				}
+			}
+		}
+	} else {
+		// Layers run to the bottom of the window, so they can overlap. Clear
+		// the changed strips first, then draw every layer's cells under any
+		// of them, or a strip cleared for one layer wipes another's text.
+		cleared.clear();
+		for (auto& l : layers) {
+			for (int y = 0; y < l.rows; y++) {
+				const Cell* front = &l.front[y * l.cols];
+				const Cell* back = &l.back[y * l.cols];
+				int first = -1, last = -1;
+				for (int x = 0; x < l.cols; x++) {
+					if (memcmp(front + x, back + x, sizeof(Cell)) != 0) {
+						first = (first < 0) ? x : first;
+						last = x;
+					}
+				}
+				if (first < 0) {
+					continue;
+				}
+				// Glyphs can overhang their cell a little, so take the neighbours along
+				first = std::max(0, first - 1);
+				last = std::min(l.cols - 1, last + 1);
+				SDL_Rect r = {l.offset.x + charSize.x * first, l.offset.y + charSize.y * y, charSize.x * (last - first + 1), charSize.y};
+				SDL_RenderFillRect(renderer, &r);
+				cleared.push_back(r);
+			}
+		}
+		for (auto& l : layers) {
+			for (auto& r : cleared) {
+				markCells(l, r);
+			}
+			for (size_t i = 0; i < l.redraw.size(); i++) {
+				if (l.redraw[i]) {
+					queueChar(l, (int)i % l.cols, (int)i / l.cols, l.back[i]);
+					l.redraw[i] = 0;
+				}
+			}
+		}
+	}
+	flush();
+	if (target) {
+		SDL_SetRenderTarget(renderer, NULL);
+		SDL_RenderCopy(renderer, target, NULL, NULL);
+	}
 	SDL_RenderPresent(renderer);
+
+	for (auto& l : layers) {
+		l.front = l.back;
+	}
+	fullRedraw = false;
+	framesDrawn++;
+	lastFrameTime = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frameStart).count();
+	frameTimes.add(lastFrameTime);
+}
+
+// Flag the cells of l that overlap r
+void GUI::markCells(Layer& l, const SDL_Rect& r) {
+	int left = r.x - l.offset.x, top = r.y - l.offset.y;
+	int right = left + r.w - 1, bottom = top + r.h - 1;
+	if (right < 0 || bottom < 0 || l.cols == 0 || l.rows == 0) {
+		return;
+	}
+	int x0 = std::max(0, left / charSize.x), x1 = std::min(l.cols - 1, right / charSize.x);
+	int y0 = std::max(0, top / charSize.y), y1 = std::min(l.rows - 1, bottom / charSize.y);
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			l.redraw[y * l.cols + x] = 1;
+		}
+	}
+}
+
+void GUI::invalidate() {
+	fullRedraw = true;
+}
+
+// Draw everything queued by drawChar() since the last flush
+void GUI::flush() {
+	if (quads.empty()) {
+		return;
+	}
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	// One call for the whole frame, with the color carried per vertex
+	vertices.resize(quads.size() * 4);
+	indices.resize(quads.size() * 6);
+	int texW, texH;
+	SDL_QueryTexture(atlas, NULL, NULL, &texW, &texH);
+	for (size_t i = 0; i < quads.size(); i++) {
+		const Quad& q = quads[i];
+		float x0 = (float)q.dst.x, y0 = (float)q.dst.y, x1 = x0 + (float)q.dst.w, y1 = y0 + (float)q.dst.h;
+		float u0 = (float)q.src.x / (float)texW, v0 = (float)q.src.y / (float)texH;
+		float u1 = (float)(q.src.x + q.src.w) / (float)texW, v1 = (float)(q.src.y + q.src.h) / (float)texH;
+		SDL_Vertex* v = &vertices[i * 4];
+		v[0] = {{x0, y0}, q.color, {u0, v0}};
+		v[1] = {{x1, y0}, q.color, {u1, v0}};
+		v[2] = {{x1, y1}, q.color, {u1, v1}};
+		v[3] = {{x0, y1}, q.color, {u0, v1}};
+		int* idx = &indices[i * 6];
+		int base = (int)i * 4;
+		idx[0] = base; idx[1] = base + 1; idx[2] = base + 2;
+		idx[3] = base; idx[4] = base + 2; idx[5] = base + 3;
+	}
+	SDL_RenderGeometry(renderer, atlas, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+#else
+	// Text comes in runs of one color, so the color only changes a few times a
+	// frame; SDL batches the copies from the same texture in between
+	SDL_Color current = quads[0].color;
+	SDL_SetTextureColorMod(atlas, current.r, current.g, current.b);
+	for (auto& q : quads) {
+		if (q.color.r != current.r || q.color.g != current.g || q.color.b != current.b) {
+			current = q.color;
+			SDL_SetTextureColorMod(atlas, current.r, current.g, current.b);
+		}
+		SDL_RenderCopy(renderer, atlas, &q.src, &q.dst);
+	}
+#endif
+	quads.clear();
 }
 
 void GUI::setTitle(std::string str) {
@@ -107,21 +324,47 @@ void GUI::setTitle(std::string str) {
 	if (str.size() > 0) {
 		t += ": " + str;
 	}
-	SDL_SetWindowTitle(win, t.c_str());
+	if (t != title) { // Called every time around the event loop
+		title = t;
+		SDL_SetWindowTitle(win, t.c_str());
+	}
 }
 
 void GUI::drawChar(int x, int y, char ch, SDL_Color color /*= Colors::BLACK*/) {
-	// Terribly inefficient, but who cares for this application. We don't need high fps.
-	SDL_Surface* textSurface = TTF_RenderGlyph_Blended(font, ch, color);
-	auto texture = SDL_CreateTextureFromSurface(renderer, textSurface);
-	int minX;
-	TTF_GlyphMetrics(font, ch, &minX, NULL, NULL, NULL, NULL);
-	SDL_Rect renderQuad = {offset.x + charSize.x * x + minX, offset.y + charSize.y * y, textSurface->w, textSurface->h};
-	if (ch == '|') { // Hack to make | show up in the right place
-		renderQuad.x = renderQuad.x - minX * 4 / 3;
+	if (layer >= layers.size()) {
+		return;
+	}
+	Layer& l = layers[layer];
+	if (x < 0 || y < 0 || x >= l.cols || y >= l.rows) {
+		return;
+	}
+	if (ch < GLYPH_FIRST || ch > GLYPH_LAST) {
+		ch = '?';
+	}
+	Cell& cell = l.back[y * l.cols + x];
+	cell.ch = ch;
+	if (ch == ' ') {
+		cell.r = cell.g = cell.b = 0;
+	} else {
+		cell.r = color.r;
+		cell.g = color.g;
+		cell.b = color.b;
+	}
+}
+
+void GUI::queueChar(const Layer& l, int x, int y, const Cell& cell) {
+	const Glyph& g = glyphs[cell.ch - GLYPH_FIRST];
+	if (g.src.w == 0) {
+		return; // Nothing to draw, e.g. space
 	}
-	SDL_RenderCopy(renderer, texture, NULL, &renderQuad);
-	SDL_DestroyTexture(texture);
+	Quad q;
+	q.src = g.src;
+	q.dst = {l.offset.x + charSize.x * x + g.minX, l.offset.y + charSize.y * y, g.src.w, g.src.h};
+	if (cell.ch == '|') { // Hack to make | show up in the right place
+		q.dst.x = q.dst.x - g.minX * 4 / 3;
+	}
+	q.color = {cell.r, cell.g, cell.b, 255};
+	quads.push_back(q);
 }
 
 void GUI::drawText(int x, int y, std::vector<std::string> texts, SDL_Color color /*= Colors::BLACK*/) {
@@ -161,6 +404,22 @@ void GUI::drawTextRel(int x, int y, std::string text, SDL_Color color /*= Colors
 void GUI::setOffset(int x, int y) {
 	offset.x = x;
 	offset.y = y;
+	// Each offset text is drawn at gets its own grid
+	for (layer = 0; layer < layers.size(); layer++) {
+		if (layers[layer].offset.x == x && layers[layer].offset.y == y) {
+			return;
+		}
+	}
+	Layer l;
+	l.offset = offset;
+	l.cols = std::max(0, (WINWIDTH - x + charSize.x - 1) / std::max(1, charSize.x));
+	l.rows = std::max(0, (WINHEIGHT - y + charSize.y - 1) / std::max(1, charSize.y));
+	const Cell blank = {' ', 0, 0, 0};
+	l.front.assign((size_t)(l.cols * l.rows), blank);
+	l.back = l.front;
+	l.redraw.assign(l.front.size(), 0);
+	layers.push_back(l);
+	fullRedraw = true;
 }
 
 int GUI::getHeight() {
@@ -179,6 +438,10 @@ int GUI::pollEvent(SDL_Event* event) {
 	return SDL_PollEvent(event);
 }
 
+void GUI::waitEvent(int timeout) {
+	SDL_WaitEventTimeout(nullptr, timeout);
+}
+
 void GUI::drawScreen(Screen* scr) {
 	scr->draw(this);
 }
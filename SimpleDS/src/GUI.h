@@ -9,6 +9,7 @@
 
 #include "narf/tokenize.h"
 #include "narf/embed.h"
+#include "narf/histogram.h"
 #include "screen.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -33,6 +34,37 @@ struct Colors {
 
 class GUI {
 private:
+	// Where each printable ASCII character is in the atlas texture
+	struct Glyph {
+		SDL_Rect src;
+		int minX;
+	};
+
+	// One character cell of the grid text is drawn on. Spaces are always
+	// stored black so cells can be compared with memcmp.
+	struct Cell {
+		char ch;
+		Uint8 r, g, b;
+	};
+
+	// Screens write into the back buffer of the grid at the current offset;
+	// render() compares it with what's on screen (front) to find what changed
+	struct Layer {
+		Point offset;
+		int cols;
+		int rows;
+		std::vector<Cell> front;
+		std::vector<Cell> back;
+		std::vector<Uint8> redraw; // Cells a partial render() has to draw again
+	};
+
+	// One character queued to be drawn when the frame is rendered
+	struct Quad {
+		SDL_Rect src;
+		SDL_Rect dst;
+		SDL_Color color;
+	};
+
 	SDL_Window* win;
 	TTF_Font* font;
 	SDL_Renderer* renderer;
@@ -41,6 +73,31 @@ private:
 	Point cursor;
 	Point charSize;
 	std::chrono::system_clock::time_point lastDraw;
+	std::string title; // Last one given to SDL
+
+	std::vector<Layer> layers;
+	size_t layer; // Index of the one at the current offset
+	SDL_Texture* target; // Keeps the last frame so only changed cells need drawing
+	bool fullRedraw;
+	uint64_t framesDrawn;
+	uint64_t framesSkipped;
+
+	SDL_Texture* atlas;
+	Glyph glyphs[95];
+	std::vector<Quad> quads;
+	std::vector<SDL_Rect> cleared; // Strips a partial render() wiped, which can cross other layers
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+#endif
+	std::chrono::steady_clock::time_point frameStart;
+	narf::Histogram frameTimes; // us, from clear() until the frame is presented, for frames that changed
+	uint64_t lastFrameTime;
+
+	bool buildAtlas();
+	void queueChar(const Layer& l, int x, int y, const Cell& cell);
+	void markCells(Layer& l, const SDL_Rect& r);
+	void flush();
 
 public:
 	GUI();
@@ -50,6 +107,7 @@ public:
 	bool isValid();
 	void clear();
 	void render();
+	void invalidate(); // Redraw everything next frame, e.g. after the window was exposed
 	void setTitle(std::string str);
 	void drawChar(int x, int y, char ch, SDL_Color color = Colors::BLACK);
 	void drawText(int x, int y, std::vector<std::string> texts, SDL_Color color = Colors::BLACK);
@@ -63,7 +121,13 @@ public:
 	int getWidth();
 	Point getCharSize();
 	int pollEvent(SDL_Event* event);
+	// Sleep until there's an event to poll or timeout ms pass
+	void waitEvent(int timeout);
 	void drawScreen(Screen* scr);
+	const narf::Histogram& getFrameTimes() { return frameTimes; }
+	uint64_t getLastFrameTime() { return lastFrameTime; }
+	uint64_t getFramesDrawn() { return framesDrawn; }
+	uint64_t getFramesSkipped() { return framesSkipped; }
 };
 
 #endif /* _GUI_H_ */
@@ -8,7 +8,7 @@
 #define _ROBORIO_H_
 
 #include "enums.h"
-#include "narf/bytestream.h"
+#include "narf/bytereader.h"
 #include <chrono>
 #include <string>
 #include <vector>
@@ -18,9 +18,8 @@
 
 class RoboRIO {
 	private:
-		std::chrono::system_clock::time_point lastPacket;
 		void reset();
-		void check();
+		void parseTag(narf::ByteReader tag);
 
 	public:
 		struct Packet {
@@ -28,7 +27,9 @@ class RoboRIO {
 			struct Control {
 				uint8_t mode : 2;
 				bool enabled : 1;
-				bool         : 4;
+				bool         : 1;
+				bool brownout: 1;
+				bool         : 2;
 				bool estop   : 1;
 				bool         : 5;
 				bool code    : 1;
@@ -62,13 +63,18 @@ class RoboRIO {
 		Output outputs[6];
 		uint8_t jsOutIdx;
 		Packet packet;
-		void parsePacket(std::string data);
-		size_t parseExtended(std::string data);
+		void parsePacket(const void* data, size_t size);
 		RoboRIO();
+		// Forget the last status so nothing reports a stale mode or enable.
+		// DS calls this when its watchdog declares comms lost.
+		void expire();
+		// Sequence numbers wrap at 16 bits, so compare them as a signed distance
+		static bool seqNewer(uint16_t a, uint16_t b) { return (int16_t)(uint16_t)(a - b) > 0; }
 		bool getEnable();
 		Mode getMode();
 		bool getCode();
 		bool getEStop();
+		bool getBrownout();
 		float getBattery();
 };
 
@@ -0,0 +1,339 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "analyzer.h"
+#include "narf/format.h"
+#include <map>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <arpa/inet.h>
+
+static const uint8_t v4Mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+std::string formatAddr(const uint8_t* addr) {
+	char buf[INET6_ADDRSTRLEN];
+	if (memcmp(addr, v4Mapped, sizeof(v4Mapped)) == 0) {
+		inet_ntop(AF_INET, addr + 12, buf, sizeof(buf));
+	} else {
+		inet_ntop(AF_INET6, addr, buf, sizeof(buf));
+	}
+	return std::string(buf);
+}
+
+size_t Analyzer::AddrHash::operator()(const Addr& a) const {
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < 16; i++) {
+		h = (h ^ a.b[i]) * 1099511628211ULL;
+	}
+	return (size_t)h;
+}
+
+Analyzer::Team::Team() : number(0), first(UINT64_MAX), last(0), dsPackets(0), dsLost(0), rioPackets(0), rioLost(0),
+	rioLate(0), rioDuplicates(0), brownouts(0), brownoutPackets(0), minBattery(0), cpuSamples(0), canSamples(0),
+	canUtilSum(0), trip(TRIP_BUCKET_US, TRIP_BUCKETS) {
+	memset(robot.b, 0, sizeof(robot.b));
+	memset(cpuSum, 0, sizeof(cpuSum));
+	memset(cpuMax, 0, sizeof(cpuMax));
+	memset(&canMax, 0, sizeof(canMax));
+	minFree.disk = minFree.ram = UINT32_MAX;
+}
+
+void Analyzer::Team::merge(const Team& o) {
+	first = std::min(first, o.first);
+	last = std::max(last, o.last);
+	dsPackets += o.dsPackets;
+	dsLost += o.dsLost;
+	rioPackets += o.rioPackets;
+	rioLost += o.rioLost;
+	rioLate += o.rioLate;
+	rioDuplicates += o.rioDuplicates;
+	brownouts += o.brownouts;
+	brownoutPackets += o.brownoutPackets;
+	if (o.minBattery > 0 && (minBattery == 0 || o.minBattery < minBattery)) {
+		minBattery = o.minBattery;
+	}
+	cpuSamples += o.cpuSamples;
+	canSamples += o.canSamples;
+	canUtilSum += o.canUtilSum;
+	for (int i = 0; i < 2; i++) {
+		cpuSum[i] += o.cpuSum[i];
+		cpuMax[i] = std::max(cpuMax[i], o.cpuMax[i]);
+	}
+	canMax.util = std::max(canMax.util, o.canMax.util);
+	canMax.busOff = std::max(canMax.busOff, o.canMax.busOff);
+	canMax.txFull = std::max(canMax.txFull, o.canMax.txFull);
+	canMax.receive = std::max(canMax.receive, o.canMax.receive);
+	canMax.transmit = std::max(canMax.transmit, o.canMax.transmit);
+	minFree.disk = std::min(minFree.disk, o.minFree.disk);
+	minFree.ram = std::min(minFree.ram, o.minFree.ram);
+	trip.merge(o.trip);
+}
+
+Analyzer::Analyzer(unsigned threads) : threads(threads), packets(0), indexSecs(0), decodeSecs(0) {
+	if (this->threads == 0) {
+		this->threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+}
+
+bool Analyzer::run(const std::string& filename) {
+	chunks.clear();
+	chunkEnds.clear();
+	edges.clear();
+	results.clear();
+	packets = 0;
+
+	// Only the record headers are read here, so this is much faster than decoding
+	auto start = std::chrono::steady_clock::now();
+	Capture cap;
+	if (!cap.open(filename)) {
+		return false;
+	}
+	Capture::Packet pkt;
+	while (true) {
+		if (packets % ANALYZER_CHUNK == 0) {
+			if (!chunks.empty()) {
+				chunkEnds.push_back(cap.tell());
+			}
+			chunks.push_back(cap.save());
+		}
+		if (!cap.next(pkt)) {
+			break;
+		}
+		packets++;
+	}
+	chunkEnds.push_back(cap.tell());
+	if (cap.isTruncated()) {
+		printf("%s: truncated or corrupt at offset %zu, analyzing up to there\n", filename.c_str(), cap.tell());
+	}
+	cap.close();
+	edges.resize(chunks.size());
+	auto indexed = std::chrono::steady_clock::now();
+	indexSecs = std::chrono::duration<double>(indexed - start).count();
+
+	std::atomic<size_t> nextChunk(0);
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> pool;
+	unsigned count = (unsigned)std::min<size_t>(threads, chunks.size());
+	for (unsigned i = 0; i < count; i++) {
+		workers.emplace_back(new Worker());
+	}
+	for (unsigned i = 0; i < count; i++) {
+		Worker* w = workers[i].get();
+		pool.emplace_back([this, w, &filename, &nextChunk]() { work(*w, filename, nextChunk); });
+	}
+	for (auto& t : pool) {
+		t.join();
+	}
+
+	// Merge what each worker saw, then stitch robots' streams across chunks
+	std::map<Addr, std::unique_ptr<Team>> merged;
+	for (auto& w : workers) {
+		for (auto& t : w->teams) {
+			auto& team = merged[t.first];
+			if (!team) {
+				team.reset(new Team());
+				team->robot = t.first;
+				team->number = t.second->number;
+			}
+			team->merge(*t.second);
+		}
+	}
+	std::map<Addr, Edge> prev;
+	for (auto& chunk : edges) {
+		for (auto& e : chunk) {
+			auto& team = *merged[e.robot];
+			auto p = prev.find(e.robot);
+			if (p == prev.end()) {
+				if (e.hasRIO && e.brownoutFirst) {
+					team.brownouts++;
+				}
+				prev[e.robot] = e;
+				continue;
+			}
+			Edge& last = p->second;
+			if (e.hasDS) {
+				int16_t d = (int16_t)(uint16_t)(e.dsFirst - last.dsLast);
+				if (last.hasDS && d > 1) {
+					team.dsLost += (uint64_t)(d - 1);
+				}
+				last.hasDS = true;
+				last.dsLast = e.dsLast;
+			}
+			if (e.hasRIO) {
+				int16_t d = (int16_t)(uint16_t)(e.rioFirst - last.rioLast);
+				if (last.hasRIO && d > 1) {
+					team.rioLost += (uint64_t)(d - 1);
+				}
+				if ((!last.hasRIO || !last.brownoutLast) && e.brownoutFirst) {
+					team.brownouts++;
+				}
+				last.hasRIO = true;
+				last.rioLast = e.rioLast;
+				last.brownoutLast = e.brownoutLast;
+			}
+		}
+	}
+	for (auto& t : merged) {
+		results.push_back(std::move(t.second));
+	}
+	std::stable_sort(results.begin(), results.end(), [](const std::unique_ptr<Team>& a, const std::unique_ptr<Team>& b) {
+		return (a->number ? a->number : UINT16_MAX) < (b->number ? b->number : UINT16_MAX);
+	});
+	decodeSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - indexed).count();
+	return true;
+}
+
+void Analyzer::work(Worker& w, const std::string& filename, std::atomic<size_t>& nextChunk) {
+	// Each worker maps the file itself; they share the page cache
+	if (!w.cap.open(filename)) {
+		return;
+	}
+	size_t chunk;
+	while ((chunk = nextChunk.fetch_add(1)) < chunks.size()) {
+		w.cap.restore(chunks[chunk]);
+		Capture::Packet pkt;
+		while (w.cap.tell() < chunkEnds[chunk] && w.cap.next(pkt)) {
+			w.decoder.decode(pkt, [&](const Message& msg) { handle(w, msg); });
+		}
+		finishChunk(w, chunk);
+	}
+	w.cap.close();
+}
+
+Analyzer::Flow& Analyzer::getFlow(Worker& w, const Addr& robot) {
+	auto& flow = w.flows[robot];
+	if (!flow) {
+		auto& team = w.teams[robot];
+		if (!team) {
+			team.reset(new Team());
+			team->robot = robot;
+			if (memcmp(robot.b, v4Mapped, sizeof(v4Mapped)) == 0 && robot.b[12] == 10) {
+				team->number = (uint16_t)(robot.b[13] * 100 + robot.b[14]);
+			}
+		}
+		flow.reset(new Flow());
+		flow->team = team.get();
+		memset(&flow->edge, 0, sizeof(flow->edge));
+		flow->edge.robot = robot;
+		memset(flow->sentSeq, 0, sizeof(flow->sentSeq));
+		memset(flow->sentAt, 0, sizeof(flow->sentAt));
+	}
+	return *flow;
+}
+
+void Analyzer::handle(Worker& w, const Message& msg) {
+	// A bad tag doesn't make the rest of the packet less real, only a short header does
+	if ((msg.type != Message::DS && msg.type != Message::ROBORIO) || msg.rawSize < 6) {
+		return;
+	}
+	Addr robot;
+	memcpy(robot.b, (msg.type == Message::DS) ? msg.dst : msg.src, sizeof(robot.b));
+	Flow& flow = getFlow(w, robot);
+	Team& team = *flow.team;
+	Edge& edge = flow.edge;
+	team.first = std::min(team.first, msg.ns);
+	team.last = std::max(team.last, msg.ns);
+
+	if (msg.type == Message::DS) {
+		uint16_t seq = msg.ds.seq;
+		team.dsPackets++;
+		flow.ds.add(seq);
+		if (!edge.hasDS) {
+			edge.hasDS = true;
+			edge.dsFirst = seq;
+		}
+		edge.dsLast = seq;
+		flow.sentSeq[seq & 0xff] = seq;
+		flow.sentAt[seq & 0xff] = msg.ns;
+		return;
+	}
+
+	uint16_t seq = msg.rio.seq;
+	team.rioPackets++;
+	flow.rio.add(seq);
+	if (flow.sentSeq[seq & 0xff] == seq && flow.sentAt[seq & 0xff] && msg.ns >= flow.sentAt[seq & 0xff]) {
+		team.trip.add((msg.ns - flow.sentAt[seq & 0xff]) / 1000);
+		flow.sentAt[seq & 0xff] = 0;
+	}
+
+	RoboRIO& status = flow.status;
+	status.parsePacket(msg.raw, msg.rawSize);
+	bool brownout = status.packet.control.brownout;
+	if (!edge.hasRIO) {
+		edge.hasRIO = true;
+		edge.rioFirst = seq;
+		edge.brownoutFirst = brownout;
+	} else if (brownout && !edge.brownoutLast) {
+		team.brownouts++;
+	}
+	edge.rioLast = seq;
+	edge.brownoutLast = brownout;
+	if (brownout) {
+		team.brownoutPackets++;
+	}
+	if (msg.rio.battery > 0 && (team.minBattery == 0 || msg.rio.battery < team.minBattery)) {
+		team.minBattery = msg.rio.battery;
+	}
+
+	if (msg.rio.tags & (1u << 0x05)) {
+		team.cpuSamples++;
+		for (int i = 0; i < 2; i++) {
+			team.cpuSum[i] += status.cpus[i];
+			team.cpuMax[i] = std::max(team.cpuMax[i], status.cpus[i]);
+		}
+	}
+	if (msg.rio.tags & (1u << 0x0e)) {
+		const RoboRIO::CAN& can = status.can;
+		team.canSamples++;
+		team.canUtilSum += can.util;
+		team.canMax.util = std::max(team.canMax.util, can.util);
+		team.canMax.busOff = std::max(team.canMax.busOff, can.busOff);
+		team.canMax.txFull = std::max(team.canMax.txFull, can.txFull);
+		team.canMax.receive = std::max(team.canMax.receive, can.receive);
+		team.canMax.transmit = std::max(team.canMax.transmit, can.transmit);
+	}
+	if (msg.rio.tags & (1u << 0x04)) {
+		team.minFree.disk = std::min(team.minFree.disk, status.usage.disk);
+	}
+	if (msg.rio.tags & (1u << 0x06)) {
+		team.minFree.ram = std::min(team.minFree.ram, status.usage.ram);
+	}
+}
+
+void Analyzer::finishChunk(Worker& w, size_t chunk) {
+	// Only this worker touches edges[chunk], so no locking
+	for (auto& f : w.flows) {
+		Flow& flow = *f.second;
+		Team& team = *flow.team;
+		team.dsLost += flow.ds.lost();
+		team.rioLost += flow.rio.lost();
+		team.rioLate += flow.rio.late();
+		team.rioDuplicates += flow.rio.duplicates();
+		edges[chunk].push_back(flow.edge);
+	}
+	w.flows.clear();
+}
+
+void Analyzer::print(FILE* out) {
+	fprintf(out, "%5s %-15s %7s %8s %6s %8s %6s %13s %9s %6s %11s %11s %5s\n", "Team", "Robot", "Secs", "DS", "Lost",
+			"Status", "Lost", "Trip p50/p99", "Brownouts", "Min V", "CPU avg/max", "CAN avg/max", "BOff");
+	for (auto& t : results) {
+		const Team& team = *t;
+		double secs = (team.last > team.first) ? (double)(team.last - team.first) / 1e9 : 0;
+		std::string number = team.number ? narf::util::format("%d", team.number) : "?";
+		std::string trip = team.trip.count() ? narf::util::format("%.1f/%.1f", (double)team.trip.percentile(50) / 1000,
+				(double)team.trip.percentile(99) / 1000) : "-";
+		std::string cpu = team.cpuSamples ? narf::util::format("%.0f/%.0f", (team.cpuSum[0] + team.cpuSum[1]) / 2 / (double)team.cpuSamples,
+				std::max(team.cpuMax[0], team.cpuMax[1])) : "-";
+		std::string can = team.canSamples ? narf::util::format("%.0f/%d", (double)team.canUtilSum / (double)team.canSamples,
+				team.canMax.util) : "-";
+		fprintf(out, "%5s %-15s %7.1f %8llu %6llu %8llu %6llu %13s %9llu %6.2f %11s %11s %5d\n", number.c_str(),
+				formatAddr(team.robot.b).c_str(), secs, (unsigned long long)team.dsPackets, (unsigned long long)team.dsLost,
+				(unsigned long long)team.rioPackets, (unsigned long long)team.rioLost, trip.c_str(),
+				(unsigned long long)team.brownouts, team.minBattery, cpu.c_str(), can.c_str(), team.canMax.busOff);
+	}
+}
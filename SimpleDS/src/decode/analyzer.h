@@ -0,0 +1,118 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _ANALYZER_H_
+#define _ANALYZER_H_
+
+#include "capture.h"
+#include "frc.h"
+#include "RoboRIO.h"
+#include "narf/histogram.h"
+#include "narf/seqtracker.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdio>
+#include <unordered_map>
+
+#define ANALYZER_CHUNK 65536 // Packets per chunk handed to a worker
+#define TRIP_BUCKET_US 100
+#define TRIP_BUCKETS 1000
+
+// Summarizes every robot in a capture. The capture is indexed into chunks of
+// packets, worker threads each claim the next unclaimed chunk until none are
+// left, and what they find is merged per robot at the end. Sums and
+// histograms merge in any order; sequence numbers and brownout state are
+// stitched together across chunk boundaries in capture order.
+class Analyzer {
+	public:
+		struct Addr {
+			uint8_t b[16]; // IPv4 is mapped into IPv6, same as Message::src
+			bool operator==(const Addr& o) const { return memcmp(b, o.b, 16) == 0; }
+			bool operator<(const Addr& o) const { return memcmp(b, o.b, 16) < 0; }
+		};
+
+		struct Team {
+			Addr robot;
+			uint16_t number; // From a 10.TE.AM.x address, 0 if it isn't one
+			uint64_t first, last; // ns
+			uint64_t dsPackets, dsLost;
+			uint64_t rioPackets, rioLost, rioLate, rioDuplicates;
+			uint64_t brownouts; // Times the roboRIO went into brownout
+			uint64_t brownoutPackets;
+			float minBattery;
+			uint64_t cpuSamples;
+			double cpuSum[2];
+			float cpuMax[2];
+			uint64_t canSamples;
+			uint64_t canUtilSum;
+			RoboRIO::CAN canMax; // Largest of each field
+			RoboRIO::Usage minFree; // Least disk/RAM free seen
+			narf::Histogram trip; // DS packet to the status echoing it, us
+
+			Team();
+			void merge(const Team& o);
+		};
+
+		explicit Analyzer(unsigned threads = 0);
+		bool run(const std::string& filename);
+		void print(FILE* out);
+
+		uint64_t getPackets() { return packets; }
+		size_t getChunks() { return chunks.size(); }
+		double getIndexSecs() { return indexSecs; }
+		double getDecodeSecs() { return decodeSecs; }
+
+	private:
+		struct AddrHash {
+			size_t operator()(const Addr& a) const;
+		};
+
+		// Where a robot's streams started and ended within one chunk
+		struct Edge {
+			Addr robot;
+			bool hasDS, hasRIO;
+			uint16_t dsFirst, dsLast;
+			uint16_t rioFirst, rioLast;
+			bool brownoutFirst, brownoutLast;
+		};
+
+		// One robot within the chunk a worker is on
+		struct Flow {
+			Team* team;
+			Edge edge;
+			narf::SeqTracker ds, rio;
+			RoboRIO status;
+			uint16_t sentSeq[256];
+			uint64_t sentAt[256];
+		};
+
+		struct Worker {
+			Capture cap;
+			Decoder decoder;
+			std::unordered_map<Addr, std::unique_ptr<Team>, AddrHash> teams;
+			std::unordered_map<Addr, std::unique_ptr<Flow>, AddrHash> flows;
+			Worker() : decoder(false) { }
+		};
+
+		unsigned threads;
+		std::vector<Capture::Cursor> chunks;
+		std::vector<size_t> chunkEnds;
+		std::vector<std::vector<Edge>> edges; // Per chunk
+		std::vector<std::unique_ptr<Team>> results;
+		uint64_t packets;
+		double indexSecs, decodeSecs;
+
+		void work(Worker& w, const std::string& filename, std::atomic<size_t>& nextChunk);
+		void handle(Worker& w, const Message& msg);
+		void finishChunk(Worker& w, size_t chunk);
+		Flow& getFlow(Worker& w, const Addr& robot);
+};
+
+std::string formatAddr(const uint8_t* addr);
+
+#endif /* _ANALYZER_H_ */
@@ -0,0 +1,248 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "capture.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PCAP_MAGIC_US 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define PCAP_HEADER_SIZE 24
+#define PCAP_RECORD_SIZE 16
+
+#define PCAPNG_SHB 0x0a0d0d0a
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_PB 0x00000002 // Obsolete, but old captures still have it
+#define PCAPNG_SPB 0x00000003
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER 0x1a2b3c4d
+#define PCAPNG_OPT_TSRESOL 9
+
+Capture::Capture() : map(nullptr), mapSize(0), pos(0), ng(false), truncated(false),
+	endian(narf::ByteReader::Endian::LITTLE), linkType(0), unitsPerSec(1000000) {
+}
+
+Capture::~Capture() {
+	close();
+}
+
+bool Capture::open(const std::string& filename) {
+	close();
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		perror(filename.c_str());
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < 12) {
+		printf("%s: not a capture file\n", filename.c_str());
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		return false;
+	}
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	map = static_cast<const uint8_t*>(p);
+	mapSize = (size_t)st.st_size;
+
+	narf::ByteReader r(map, mapSize);
+	uint32_t magic = r.readU32(LE);
+	if (magic == PCAPNG_SHB) {
+		ng = true;
+	} else if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS) {
+		endian = narf::ByteReader::Endian::LITTLE;
+	} else if (__builtin_bswap32(magic) == PCAP_MAGIC_US || __builtin_bswap32(magic) == PCAP_MAGIC_NS) {
+		endian = narf::ByteReader::Endian::BIG;
+		magic = __builtin_bswap32(magic);
+	} else {
+		printf("%s: not a pcap or pcapng file\n", filename.c_str());
+		close();
+		return false;
+	}
+	if (!ng) {
+		if (mapSize < PCAP_HEADER_SIZE) {
+			close();
+			return false;
+		}
+		unitsPerSec = (magic == PCAP_MAGIC_NS) ? 1000000000 : 1000000;
+		r.seek(20);
+		linkType = (uint16_t)r.readU32(endian);
+	}
+	rewind();
+	return true;
+}
+
+void Capture::close() {
+	if (map) {
+		munmap((void*)map, mapSize);
+	}
+	map = nullptr;
+	mapSize = 0;
+	pos = 0;
+	ng = false;
+	truncated = false;
+	interfaces.clear();
+}
+
+void Capture::rewind() {
+	pos = ng ? 0 : PCAP_HEADER_SIZE;
+	truncated = false;
+	interfaces.clear();
+}
+
+Capture::Cursor Capture::save() const {
+	Cursor c;
+	c.pos = pos;
+	c.endian = endian;
+	c.interfaces = interfaces;
+	return c;
+}
+
+void Capture::restore(const Cursor& cursor) {
+	pos = (cursor.pos < mapSize) ? cursor.pos : mapSize;
+	endian = cursor.endian;
+	interfaces = cursor.interfaces;
+	truncated = false;
+}
+
+uint64_t Capture::toNs(uint64_t ts, uint64_t unitsPerSec) {
+	if (unitsPerSec == 1000000000) {
+		return ts;
+	} else if (unitsPerSec == 1000000) {
+		return ts * 1000;
+	}
+	return (uint64_t)((long double)ts * 1e9L / (long double)unitsPerSec);
+}
+
+bool Capture::next(Packet& pkt) {
+	if (!map) {
+		return false;
+	}
+	return ng ? nextPcapNG(pkt) : nextPcap(pkt);
+}
+
+bool Capture::nextPcap(Packet& pkt) {
+	if (mapSize - pos < PCAP_RECORD_SIZE) {
+		truncated = (pos != mapSize);
+		return false;
+	}
+	narf::ByteReader r(map + pos, PCAP_RECORD_SIZE, endian);
+	uint32_t sec = r.readU32();
+	uint32_t frac = r.readU32();
+	uint32_t incl = r.readU32();
+	uint32_t orig = r.readU32();
+	if (incl > mapSize - pos - PCAP_RECORD_SIZE) {
+		truncated = true;
+		return false;
+	}
+	pkt.ns = (uint64_t)sec * 1000000000 + toNs(frac, unitsPerSec);
+	pkt.linkType = linkType;
+	pkt.origSize = orig;
+	pkt.data = map + pos + PCAP_RECORD_SIZE;
+	pkt.size = incl;
+	pos += PCAP_RECORD_SIZE + incl;
+	return true;
+}
+
+void Capture::parseInterface(narf::ByteReader body) {
+	Interface iface;
+	iface.linkType = body.readU16();
+	iface.unitsPerSec = 1000000;
+	body.skip(6); // Reserved, snaplen
+	while (body.bytesLeft() >= 4) {
+		uint16_t code = body.readU16();
+		uint16_t len = body.readU16();
+		auto opt = body.sub(len);
+		body.skip((4 - len % 4) % 4);
+		if (code == 0) {
+			break;
+		} else if (code == PCAPNG_OPT_TSRESOL && len >= 1) {
+			uint8_t v = opt.readU8();
+			uint64_t units = 1;
+			for (int i = 0; i < (v & 0x7f) && units < UINT64_MAX / 10; i++) {
+				units *= (v & 0x80) ? 2 : 10;
+			}
+			iface.unitsPerSec = units;
+		}
+	}
+	interfaces.push_back(iface);
+}
+
+bool Capture::nextPcapNG(Packet& pkt) {
+	while (mapSize - pos >= 12) {
+		narf::ByteReader hdr(map + pos, 8, endian);
+		uint32_t type = hdr.readU32(LE); // The section magic reads the same either way
+		if (type == PCAPNG_SHB) {
+			narf::ByteReader shb(map + pos + 8, 4);
+			uint32_t order = shb.readU32(LE);
+			if (order == PCAPNG_BYTE_ORDER) {
+				endian = narf::ByteReader::Endian::LITTLE;
+			} else if (order == __builtin_bswap32(PCAPNG_BYTE_ORDER)) {
+				endian = narf::ByteReader::Endian::BIG;
+			} else {
+				break;
+			}
+			interfaces.clear();
+			hdr = narf::ByteReader(map + pos, 8, endian);
+			type = hdr.readU32();
+		} else {
+			hdr.seek(0);
+			type = hdr.readU32(endian);
+		}
+		uint32_t len = hdr.readU32(endian);
+		if (len < 12 || len % 4 != 0 || len > mapSize - pos) {
+			break;
+		}
+		narf::ByteReader body(map + pos + 8, len - 12, endian);
+		pos += len;
+
+		if (type == PCAPNG_IDB) {
+			parseInterface(body);
+		} else if (type == PCAPNG_EPB || type == PCAPNG_PB) {
+			uint32_t ifIdx;
+			if (type == PCAPNG_EPB) {
+				ifIdx = body.readU32();
+			} else {
+				ifIdx = body.readU16();
+				body.skip(2); // Drops count
+			}
+			uint64_t ts = ((uint64_t)body.readU32() << 32);
+			ts |= body.readU32();
+			uint32_t incl = body.readU32();
+			uint32_t orig = body.readU32();
+			if (ifIdx >= interfaces.size() || incl > body.bytesLeft()) {
+				continue;
+			}
+			auto& iface = interfaces[ifIdx];
+			pkt.ns = toNs(ts, iface.unitsPerSec);
+			pkt.linkType = iface.linkType;
+			pkt.origSize = orig;
+			pkt.data = body.cur();
+			pkt.size = incl;
+			return true;
+		} else if (type == PCAPNG_SPB) {
+			if (interfaces.empty()) {
+				continue;
+			}
+			uint32_t orig = body.readU32();
+			pkt.ns = 0;
+			pkt.linkType = interfaces[0].linkType;
+			pkt.origSize = orig;
+			pkt.data = body.cur();
+			pkt.size = (orig < body.bytesLeft()) ? orig : (uint32_t)body.bytesLeft();
+			return true;
+		}
+		// Anything else (statistics, name resolution, custom) isn't needed
+	}
+	truncated = (pos != mapSize);
+	return false;
+}
@@ -0,0 +1,85 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "narf/bytereader.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Link-layer types we know how to get an IP packet out of
+#define LINKTYPE_NULL 0
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+#define LINKTYPE_IPV4 228
+#define LINKTYPE_IPV6 229
+#define LINKTYPE_LINUX_SLL2 276
+
+// Streams packets out of a pcap or pcapng file. The file is memory-mapped
+// rather than read in, so packet data points straight into the map and
+// stays valid until close().
+class Capture {
+	public:
+		struct Packet {
+			uint64_t ns; // Since the epoch, 0 if the capture didn't record one
+			uint16_t linkType;
+			uint32_t origSize;
+			const uint8_t* data;
+			uint32_t size;
+		};
+
+		struct Interface {
+			uint16_t linkType;
+			uint64_t unitsPerSec;
+		};
+
+		// Everything needed to pick up reading at a given packet, so several
+		// Captures of the same file can each read a different part of it
+		struct Cursor {
+			size_t pos;
+			narf::ByteReader::Endian endian;
+			std::vector<Interface> interfaces; // pcapng only
+		};
+
+		Capture();
+		~Capture();
+		bool open(const std::string& filename);
+		void close();
+		bool next(Packet& pkt);
+		void rewind();
+		Cursor save() const;
+		void restore(const Cursor& cursor);
+
+		size_t size() { return mapSize; }
+		size_t tell() { return pos; }
+		bool isNG() { return ng; }
+		bool isTruncated() { return truncated; } // Stopped at a partial or corrupt block
+
+	private:
+		const uint8_t* map;
+		size_t mapSize;
+		size_t pos;
+		bool ng;
+		bool truncated;
+		narf::ByteReader::Endian endian;
+
+		// pcap
+		uint16_t linkType;
+		uint64_t unitsPerSec;
+
+		// pcapng, reset by every section header
+		std::vector<Interface> interfaces;
+
+		bool nextPcap(Packet& pkt);
+		bool nextPcapNG(Packet& pkt);
+		void parseInterface(narf::ByteReader body);
+		static uint64_t toNs(uint64_t ts, uint64_t unitsPerSec);
+};
+
+#endif /* _CAPTURE_H_ */
@@ -0,0 +1,609 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "frc.h"
+#include "narf/format.h"
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_IPV6 0x86dd
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_QINQ 0x88a8
+#define IPPROTO_TCP_ 6
+#define IPPROTO_UDP_ 17
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+
+#define SIDECHANNEL_MAX 4096 // Same guess as FRC_SideChannel.lua
+#define NT_UNKNOWN SIZE_MAX
+
+const char* Message::typeNames[Message::COUNT] = {"DS", "RoboRIO", "FMS->DS", "DS->FMS", "NetConsole", "SideChannel", "NetworkTable"};
+
+bool Decoder::FlowKey::operator==(const FlowKey& o) const {
+	return srcPort == o.srcPort && dstPort == o.dstPort && memcmp(src, o.src, 16) == 0 && memcmp(dst, o.dst, 16) == 0;
+}
+
+size_t Decoder::FlowHash::operator()(const FlowKey& k) const {
+	// FNV-1a over the addresses and ports
+	uint64_t h = 14695981039346656037ULL;
+	auto mix = [&h](const uint8_t* p, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			h = (h ^ p[i]) * 1099511628211ULL;
+		}
+	};
+	mix(k.src, 16);
+	mix(k.dst, 16);
+	mix((const uint8_t*)&k.srcPort, 2);
+	mix((const uint8_t*)&k.dstPort, 2);
+	return (size_t)h;
+}
+
+Decoder::Decoder(bool streams) : streams(streams) {
+	memset(&stats, 0, sizeof(stats));
+}
+
+void Decoder::emit(Message& msg, const MessageHandler& handler) {
+	stats.messages[msg.type]++;
+	if (msg.malformed) {
+		stats.malformed[msg.type]++;
+	}
+	if (handler) {
+		handler(msg);
+	}
+}
+
+void Decoder::decode(const Capture::Packet& pkt, const MessageHandler& handler) {
+	stats.packets++;
+	stats.bytes += pkt.size;
+	narf::ByteReader r(pkt.data, pkt.size, BE);
+	uint16_t proto = 0;
+
+	switch (pkt.linkType) {
+		case LINKTYPE_ETHERNET:
+			r.skip(12);
+			proto = r.readU16();
+			while (proto == ETHERTYPE_VLAN || proto == ETHERTYPE_QINQ) {
+				r.skip(2);
+				proto = r.readU16();
+			}
+			break;
+		case LINKTYPE_LINUX_SLL:
+			r.skip(14);
+			proto = r.readU16();
+			break;
+		case LINKTYPE_LINUX_SLL2:
+			proto = r.readU16();
+			r.skip(18);
+			break;
+		case LINKTYPE_NULL:
+			r.skip(4); // Address family, in the capturing host's byte order
+			proto = ETHERTYPE_IPV4; // Checked against the IP version below
+			break;
+		case LINKTYPE_RAW: case LINKTYPE_IPV4: case LINKTYPE_IPV6:
+			proto = ETHERTYPE_IPV4;
+			break;
+	}
+	if (r.overran() || (proto != ETHERTYPE_IPV4 && proto != ETHERTYPE_IPV6)) {
+		stats.notIP++;
+		return;
+	}
+	decodeIP(r.sub(r.bytesLeft()), pkt.ns, handler);
+}
+
+void Decoder::decodeIP(narf::ByteReader r, uint64_t ns, const MessageHandler& handler) {
+	FlowKey key;
+	memset(&key, 0, sizeof(key));
+	uint8_t proto;
+	narf::ByteReader payload;
+
+	uint8_t version = (uint8_t)(r.size() ? (r.data()[0] >> 4) : 0);
+	if (version == 4) {
+		uint8_t ihl = (uint8_t)((r.readU8() & 0x0f) * 4);
+		r.skip(1);
+		uint16_t total = r.readU16();
+		r.skip(2);
+		uint16_t frag = r.readU16();
+		r.skip(1);
+		proto = r.readU8();
+		r.skip(2);
+		key.src[10] = key.src[11] = 0xff; // v4-mapped
+		key.dst[10] = key.dst[11] = 0xff;
+		r.read(key.src + 12, 4);
+		r.read(key.dst + 12, 4);
+		if (r.overran() || ihl < 20 || total < ihl || (frag & 0x3fff) != 0) {
+			stats.notIP++; // Fragments would need reassembly, FRC traffic doesn't fragment
+			return;
+		}
+		r.seek(ihl);
+		payload = r.sub(total - ihl);
+	} else if (version == 6) {
+		r.skip(4);
+		uint16_t len = r.readU16();
+		proto = r.readU8();
+		r.skip(1);
+		r.read(key.src, 16);
+		r.read(key.dst, 16);
+		payload = r.sub(len);
+		// Walk past extension headers
+		while (proto == 0 || proto == 43 || proto == 60) {
+			proto = payload.readU8();
+			payload.skip(7 + payload.readU8() * 8u - 1);
+		}
+		if (payload.overran() || proto == 44) {
+			stats.notIP++;
+			return;
+		}
+		payload = payload.sub(payload.bytesLeft());
+	} else {
+		stats.notIP++;
+		return;
+	}
+
+	if (proto == IPPROTO_UDP_) {
+		decodeUDP(payload, key, ns, handler);
+	} else if (proto == IPPROTO_TCP_ && streams) {
+		decodeTCP(payload, key, ns, handler);
+	} else {
+		stats.otherPorts++;
+	}
+}
+
+void Decoder::decodeUDP(narf::ByteReader r, const FlowKey& key, uint64_t ns, const MessageHandler& handler) {
+	uint16_t srcPort = r.readU16();
+	uint16_t dstPort = r.readU16();
+	uint16_t len = r.readU16();
+	r.skip(2);
+	if (r.overran() || len < 8) {
+		stats.otherPorts++;
+		return;
+	}
+	auto data = r.sub(len - 8u);
+
+	Message msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.ns = ns;
+	msg.src = key.src;
+	msg.dst = key.dst;
+	msg.raw = data.data();
+	msg.rawSize = (uint32_t)data.size();
+	bool ok;
+	if (dstPort == PORT_DS || dstPort == PORT_DS_ALT) {
+		ok = decodeDS(data, msg);
+	} else if (dstPort == PORT_ROBORIO) {
+		ok = decodeRoboRIO(data, msg);
+	} else if (dstPort == PORT_FMS_DS) {
+		ok = decodeFMS_DS(data, msg);
+	} else if (dstPort == PORT_DS_FMS) {
+		ok = decodeDS_FMS(data, msg);
+	} else if (dstPort == PORT_NETCONSOLE || srcPort == PORT_NETCONSOLE) {
+		msg.type = Message::NETCONSOLE;
+		msg.text = (const char*)data.data();
+		msg.textSize = (uint16_t)data.size();
+		ok = true;
+	} else {
+		stats.otherPorts++;
+		return;
+	}
+	msg.malformed = !ok;
+	emit(msg, handler);
+}
+
+void Decoder::decodeTCP(narf::ByteReader r, FlowKey& key, uint64_t ns, const MessageHandler& handler) {
+	key.srcPort = r.readU16();
+	key.dstPort = r.readU16();
+	uint32_t seq = r.readU32();
+	r.skip(4);
+	uint8_t offset = (uint8_t)((r.readU8() >> 4) * 4);
+	uint8_t flags = r.readU8();
+	bool side = (key.srcPort == PORT_SIDECHANNEL || key.dstPort == PORT_SIDECHANNEL);
+	bool nt = (key.srcPort == PORT_NETWORKTABLE || key.dstPort == PORT_NETWORKTABLE);
+	if (r.overran() || offset < 20 || (!side && !nt)) {
+		stats.otherPorts++;
+		return;
+	}
+	r.seek(offset);
+	const uint8_t* data = r.cur();
+	uint32_t size = (uint32_t)r.bytesLeft();
+
+	Flow& flow = flows[key];
+	if (flags & TCP_SYN) {
+		flow.synced = true;
+		flow.nextSeq = seq + 1;
+		flow.buf.clear();
+		flow.start = 0;
+		flow.ntTypes.clear();
+	}
+	if (size) {
+		if (!flow.synced) {
+			// Capture started mid-connection; hope we're at a message boundary
+			flow.synced = true;
+			flow.nextSeq = seq;
+		}
+		int32_t d = (int32_t)(seq - flow.nextSeq);
+		if (d > 0) {
+			stats.tcpGaps++; // Lost something, start over at this segment
+			flow.buf.clear();
+			flow.start = 0;
+			flow.nextSeq = seq;
+			d = 0;
+		}
+		if ((uint32_t)-d < size) { // Skip whatever part is a retransmit
+			flow.buf.insert(flow.buf.end(), data - d, data + size);
+			flow.nextSeq = seq + size;
+		}
+
+		size_t used;
+		do {
+			const uint8_t* p = flow.buf.data() + flow.start;
+			size_t left = flow.buf.size() - flow.start;
+			used = left ? (side ? decodeSideChannel(key, p, left, ns, handler) : decodeNetworkTable(key, flow, p, left, ns, handler)) : 0;
+			flow.start += used;
+		} while (used);
+		if (flow.start == flow.buf.size()) {
+			flow.buf.clear();
+			flow.start = 0;
+		} else if (flow.start > 4096) {
+			flow.buf.erase(flow.buf.begin(), flow.buf.begin() + (long)flow.start);
+			flow.start = 0;
+		}
+	}
+	if (flags & (TCP_FIN | TCP_RST)) {
+		flows.erase(key);
+	}
+}
+
+size_t Decoder::decodeSideChannel(const FlowKey& key, const uint8_t* data, size_t size, uint64_t ns, const MessageHandler& handler) {
+	narf::ByteReader r(data, size, BE);
+	uint16_t len = r.readU16();
+	if (r.overran()) {
+		return 0;
+	}
+	if (len > SIDECHANNEL_MAX) {
+		return 1; // Not a length, slide forward until something looks like one
+	}
+	if (r.bytesLeft() < len) {
+		return 0;
+	}
+	if (len == 0) {
+		return 2;
+	}
+
+	Message msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.type = Message::SIDECHANNEL;
+	msg.ns = ns;
+	msg.src = key.src;
+	msg.dst = key.dst;
+	msg.raw = data;
+	msg.rawSize = (uint32_t)(len + 2u);
+	msg.side.id = r.readU8();
+	auto body = r.sub(len - 1u);
+	if (msg.side.id == 0x00) {
+		msg.text = (const char*)body.data();
+		msg.textSize = (uint16_t)body.size();
+	} else if (msg.side.id == 0x02) {
+		msg.side.jsIdx = body.readU8();
+		msg.side.jsConnected = body.readU8() != 0;
+		body.skip(1);
+		uint8_t nameLen = body.readU8();
+		msg.text = (const char*)body.cur();
+		msg.textSize = (uint16_t)(nameLen < body.bytesLeft() ? nameLen : body.bytesLeft());
+		msg.malformed = body.overran() || nameLen > body.bytesLeft();
+	} else if (msg.side.id == 0x04 || msg.side.id == 0x05) {
+		size_t count = (msg.side.id == 0x04) ? 2 : 3;
+		msg.malformed = (body.size() != count * 2);
+		for (size_t i = 0; i < count; i++) {
+			msg.side.faults[i] = body.readU16();
+		}
+	}
+	emit(msg, handler);
+	return len + 2u;
+}
+
+size_t Decoder::ntValueSize(narf::ByteReader r, uint8_t type) {
+	if (type == 0x00) { // Boolean
+		return 1;
+	} else if (type == 0x01) { // Double
+		return 8;
+	} else if (type == 0x02) { // String
+		uint16_t len = r.readU16();
+		return r.overran() ? 0 : 2u + len;
+	} else if (type == 0x10 || type == 0x11 || type == 0x12) { // Arrays
+		uint16_t count = r.readU16();
+		if (r.overran()) {
+			return 0;
+		}
+		if (type != 0x12) {
+			return 2u + count * ntValueSize(r, (uint8_t)(type & 0x0f));
+		}
+		size_t total = 2;
+		for (uint16_t i = 0; i < count; i++) {
+			size_t n = ntValueSize(r, 0x02);
+			if (n == 0) {
+				return 0;
+			}
+			r.skip(n);
+			total += n;
+		}
+		return total;
+	}
+	return NT_UNKNOWN;
+}
+
+size_t Decoder::decodeNetworkTable(const FlowKey& key, Flow& flow, const uint8_t* data, size_t size, uint64_t ns, const MessageHandler& handler) {
+	narf::ByteReader r(data, size, BE);
+	Message msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.type = Message::NETWORKTABLE;
+	msg.ns = ns;
+	msg.src = key.src;
+	msg.dst = key.dst;
+	msg.raw = data;
+	msg.nt.msgType = r.readU8();
+
+	switch (msg.nt.msgType) {
+		case 0x00: // Keep alive
+		case 0x03: // Server hello complete
+			break;
+		case 0x01: // Client hello
+		case 0x02: // Protocol revision unsupported
+			msg.nt.revision = r.readU16();
+			break;
+		case 0x10: { // Entry assignment
+			uint16_t nameLen = r.readU16();
+			msg.text = (const char*)r.cur();
+			msg.textSize = nameLen;
+			r.skip(nameLen);
+			msg.nt.entryType = r.readU8();
+			msg.nt.id = r.readU16();
+			msg.nt.seq = r.readU16();
+			if (r.overran()) {
+				return 0;
+			}
+			size_t n = ntValueSize(r, msg.nt.entryType);
+			if (n == NT_UNKNOWN) {
+				msg.malformed = true;
+				r.skip(r.bytesLeft());
+				break;
+			}
+			if (n == 0 || n > r.bytesLeft()) {
+				return 0;
+			}
+			r.skip(n);
+			if (msg.nt.id != 0xffff) {
+				flow.ntTypes[msg.nt.id] = msg.nt.entryType;
+			}
+			break;
+		}
+		case 0x11: { // Entry update
+			msg.nt.id = r.readU16();
+			msg.nt.seq = r.readU16();
+			if (r.overran()) {
+				return 0;
+			}
+			auto type = flow.ntTypes.find(msg.nt.id);
+			if (type == flow.ntTypes.end()) {
+				// Never saw the assignment, so there's no way to know how long this is
+				msg.malformed = true;
+				r.skip(r.bytesLeft());
+				break;
+			}
+			msg.nt.entryType = type->second;
+			size_t n = ntValueSize(r, msg.nt.entryType);
+			if (n == 0 || n > r.bytesLeft()) {
+				return 0;
+			}
+			r.skip(n);
+			break;
+		}
+		default:
+			msg.malformed = true;
+			r.skip(r.bytesLeft());
+			break;
+	}
+	if (r.overran()) {
+		return 0;
+	}
+	msg.rawSize = (uint32_t)r.tell();
+	emit(msg, handler);
+	return r.tell();
+}
+
+bool Decoder::decodeDS(narf::ByteReader r, Message& msg) {
+	msg.type = Message::DS;
+	msg.ds.seq = r.readU16(BE);
+	r.skip(1); // Comm version
+	msg.ds.control = r.readU8();
+	msg.ds.request = r.readU8();
+	msg.ds.station = r.readU8();
+	bool ok = !r.overran();
+	while (r.bytesLeft() > 1) {
+		auto tag = r.sub(r.readU8());
+		uint8_t id = tag.readU8();
+		if (id == 0x0c && msg.ds.joystickCount < 6) {
+			auto& js = msg.ds.joysticks[msg.ds.joystickCount++];
+			js.axes = tag.readU8();
+			tag.skip(js.axes);
+			js.buttons = tag.readU8();
+			tag.skip((js.buttons + 7u) / 8u);
+			js.povs = tag.readU8();
+			tag.skip(js.povs * 2u);
+		} else if (id == 0x0f) {
+			msg.ds.hasDate = true;
+			tag.skip(10);
+		} else if (id == 0x10) {
+			msg.text = (const char*)tag.cur();
+			msg.textSize = (uint16_t)tag.bytesLeft();
+		}
+		ok = ok && !tag.overran();
+	}
+	return ok && !r.overran();
+}
+
+bool Decoder::decodeRoboRIO(narf::ByteReader r, Message& msg) {
+	msg.type = Message::ROBORIO;
+	msg.rio.seq = r.readU16(BE);
+	r.skip(1); // Comm version
+	msg.rio.control = r.readU16(BE);
+	uint8_t volts = r.readU8();
+	uint8_t frac = r.readU8();
+	msg.rio.battery = (float)volts + ((float)frac * 99 / 255 / 100); // Same guess as RoboRIO::getBattery()
+	msg.rio.requestDate = r.readU8() != 0;
+	bool ok = !r.overran();
+	while (r.bytesLeft() > 1) {
+		auto tag = r.sub(r.readU8());
+		uint8_t id = tag.readU8();
+		if (id < 32) {
+			msg.rio.tags |= 1u << id;
+		}
+		if (id == 0x01 && msg.rio.outputCount < 6) {
+			msg.rio.outputs[msg.rio.outputCount++] = (tag.size() > 1) ? tag.readU32(BE) : 0;
+		} else if (id == 0x04) {
+			tag.skip(3);
+			msg.rio.disk = tag.readU32(BE);
+		} else if (id == 0x05) {
+			msg.rio.cpuCount = tag.readU8();
+			for (int i = 0; i < 2 && i < msg.rio.cpuCount; i++) {
+				msg.rio.cpus[i] = tag.readFloat(BE);
+				tag.skip(12);
+			}
+		} else if (id == 0x06) {
+			tag.skip(3);
+			msg.rio.ram = tag.readU32(BE);
+		} else if (id == 0x0e) {
+			tag.skip(9);
+			msg.rio.canUtil = tag.readU8();
+		}
+		ok = ok && !tag.overran();
+	}
+	return ok && !r.overran();
+}
+
+bool Decoder::decodeFMS_DS(narf::ByteReader r, Message& msg) {
+	msg.type = Message::FMS_DS;
+	msg.fms.seq = r.readU16(BE);
+	r.skip(1); // Comm version
+	msg.fms.control = r.readU8();
+	r.skip(1);
+	msg.fms.station = r.readU8();
+	msg.fms.level = r.readU8();
+	msg.fms.match = r.readU16(BE);
+	msg.fms.play = r.readU8();
+	r.skip(10); // Date
+	msg.fms.timeLeft = r.readU16(BE);
+	return !r.overran();
+}
+
+bool Decoder::decodeDS_FMS(narf::ByteReader r, Message& msg) {
+	msg.type = Message::DS_FMS;
+	msg.dsfms.seq = r.readU16(BE);
+	r.skip(1); // Comm version
+	msg.dsfms.control = r.readU8();
+	msg.dsfms.team = r.readU16(BE);
+	uint8_t volts = r.readU8();
+	uint8_t frac = r.readU8();
+	msg.dsfms.battery = (float)volts + ((float)frac * 99 / 255 / 100);
+	return !r.overran();
+}
+
+static std::string stationName(uint8_t station) {
+	if (station < 6) {
+		return narf::util::format("%s %d", station < 3 ? "Red" : "Blue", station % 3 + 1);
+	}
+	return narf::util::format("?%d", station);
+}
+
+static std::string controlName(uint8_t control) {
+	static const char* modes[] = {"TeleOp", "Test", "Auton", "?"};
+	if (control & 0x80) {
+		return "E-Stopped";
+	}
+	return narf::util::format("%s %s", modes[control & 0x03], (control & 0x04) ? "Enabled" : "Disabled");
+}
+
+std::string formatMessage(const Message& msg) {
+	std::string s = narf::util::format("%llu.%09llu %-12s", (unsigned long long)(msg.ns / 1000000000),
+			(unsigned long long)(msg.ns % 1000000000), Message::typeNames[msg.type]);
+	std::string text(msg.text ? msg.text : "", msg.textSize);
+	switch (msg.type) {
+		case Message::DS:
+			s += narf::util::format(" seq %5d  %-16s  %-6s  js %d", msg.ds.seq, controlName(msg.ds.control).c_str(),
+					stationName(msg.ds.station).c_str(), msg.ds.joystickCount);
+			if (msg.ds.request & 0x08) {
+				s += "  reboot";
+			}
+			if (msg.ds.request & 0x04) {
+				s += "  restart code";
+			}
+			if (msg.ds.hasDate) {
+				s += "  date";
+			}
+			if (msg.textSize) {
+				s += "  tz " + text;
+			}
+			break;
+		case Message::ROBORIO:
+			s += narf::util::format(" seq %5d  %-16s  %5.2f V  code %s", msg.rio.seq, controlName((uint8_t)(msg.rio.control >> 8)).c_str(),
+					msg.rio.battery, (msg.rio.control & 0x20) ? "yes" : "no");
+			if (msg.rio.cpuCount) {
+				s += narf::util::format("  cpu %.1f %.1f", msg.rio.cpus[0], msg.rio.cpus[1]);
+			}
+			if (msg.rio.ram) {
+				s += narf::util::format("  ram %u", msg.rio.ram);
+			}
+			if (msg.rio.disk) {
+				s += narf::util::format("  disk %u", msg.rio.disk);
+			}
+			if (msg.rio.requestDate) {
+				s += "  request date";
+			}
+			break;
+		case Message::FMS_DS:
+			s += narf::util::format(" seq %5d  %-16s  %-6s  level %d  match %d-%d  left %d", msg.fms.seq, controlName(msg.fms.control).c_str(),
+					stationName(msg.fms.station).c_str(), msg.fms.level, msg.fms.match, msg.fms.play, msg.fms.timeLeft);
+			break;
+		case Message::DS_FMS:
+			s += narf::util::format(" seq %5d  %-16s  team %d  %5.2f V", msg.dsfms.seq, controlName(msg.dsfms.control).c_str(),
+					msg.dsfms.team, msg.dsfms.battery);
+			break;
+		case Message::NETCONSOLE:
+			while (text.size() && (text.back() == '\n' || text.back() == '\r' || text.back() == '\0')) {
+				text.pop_back();
+			}
+			s += " " + text;
+			break;
+		case Message::SIDECHANNEL:
+			if (msg.side.id == 0x00) {
+				s += " message: " + text;
+			} else if (msg.side.id == 0x02) {
+				s += narf::util::format(" joystick %d %s \"%s\"", msg.side.jsIdx, msg.side.jsConnected ? "connected" : "disconnected", text.c_str());
+			} else if (msg.side.id == 0x04) {
+				s += narf::util::format(" faults  comms %d  12V %d", msg.side.faults[0], msg.side.faults[1]);
+			} else if (msg.side.id == 0x05) {
+				s += narf::util::format(" faults  6V %d  5V %d  3.3V %d", msg.side.faults[0], msg.side.faults[1], msg.side.faults[2]);
+			} else {
+				s += narf::util::format(" id 0x%02x, %u bytes", msg.side.id, msg.rawSize);
+			}
+			break;
+		case Message::NETWORKTABLE:
+			s += narf::util::format(" type 0x%02x", msg.nt.msgType);
+			if (msg.nt.msgType == 0x01 || msg.nt.msgType == 0x02) {
+				s += narf::util::format("  revision 0x%04x", msg.nt.revision);
+			} else if (msg.nt.msgType == 0x10 || msg.nt.msgType == 0x11) {
+				s += narf::util::format("  id %04x  seq %d  entry type 0x%02x", msg.nt.id, msg.nt.seq, msg.nt.entryType);
+				if (msg.textSize) {
+					s += "  \"" + text + "\"";
+				}
+			}
+			break;
+		case Message::COUNT:
+			break;
+	}
+	if (msg.malformed) {
+		s += "  [malformed]";
+	}
+	return s;
+}
@@ -0,0 +1,177 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _FRC_H_
+#define _FRC_H_
+
+#include "capture.h"
+#include "narf/bytereader.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+// Ports, as registered by FRC_Dissectors/*.lua
+#define PORT_DS 1110
+#define PORT_DS_ALT 1115
+#define PORT_FMS_DS 1120
+#define PORT_ROBORIO 1150
+#define PORT_DS_FMS 1160
+#define PORT_NETCONSOLE 6666
+#define PORT_NETWORKTABLE 1735
+#define PORT_SIDECHANNEL 1740
+
+// One decoded FRC protocol message. Pointers (raw, text) point into the
+// capture or a reassembly buffer and are only valid during the callback.
+struct Message {
+	enum Type { DS, ROBORIO, FMS_DS, DS_FMS, NETCONSOLE, SIDECHANNEL, NETWORKTABLE, COUNT };
+	static const char* typeNames[COUNT];
+
+	Type type;
+	uint64_t ns;
+	const uint8_t* src; // 16 byte addresses, IPv4 is mapped into IPv6
+	const uint8_t* dst;
+	const uint8_t* raw;
+	uint32_t rawSize;
+	const char* text; // NetConsole line, SideChannel message, NT entry name, DS timezone
+	uint16_t textSize;
+	bool malformed;
+
+	struct Joystick {
+		uint8_t axes;
+		uint8_t buttons;
+		uint8_t povs;
+	};
+
+	struct DSInfo {
+		uint16_t seq;
+		uint8_t control;
+		uint8_t request;
+		uint8_t station;
+		uint8_t joystickCount;
+		Joystick joysticks[6];
+		bool hasDate;
+	};
+	struct RoboRIOInfo {
+		uint16_t seq;
+		uint16_t control;
+		float battery;
+		bool requestDate;
+		uint8_t outputCount;
+		uint32_t outputs[6];
+		uint8_t cpuCount;
+		float cpus[2];
+		uint32_t disk;
+		uint32_t ram;
+		uint8_t canUtil;
+		uint32_t tags; // Bit n set if a tag with id n was in the packet
+	};
+	struct FMSInfo {
+		uint16_t seq;
+		uint8_t control;
+		uint8_t station;
+		uint8_t level;
+		uint16_t match;
+		uint8_t play;
+		uint16_t timeLeft;
+	};
+	struct DSFMSInfo {
+		uint16_t seq;
+		uint8_t control;
+		uint16_t team;
+		float battery;
+	};
+	struct SideChannelInfo {
+		uint8_t id;
+		uint8_t jsIdx;
+		bool jsConnected;
+		uint16_t faults[3]; // Comms, 12V for 0x04; 6V, 5V, 3.3V for 0x05
+	};
+	struct NetworkTableInfo {
+		uint8_t msgType;
+		uint8_t entryType;
+		uint16_t id;
+		uint16_t seq;
+		uint16_t revision;
+	};
+
+	union {
+		DSInfo ds;
+		RoboRIOInfo rio;
+		FMSInfo fms;
+		DSFMSInfo dsfms;
+		SideChannelInfo side;
+		NetworkTableInfo nt;
+	};
+};
+
+typedef std::function<void(const Message&)> MessageHandler;
+
+// Decodes the FRC protocols out of captured frames. UDP protocols are
+// decoded per datagram; SideChannel and NetworkTable run over TCP, so each
+// direction of each connection is reassembled in order first.
+class Decoder {
+	public:
+		struct Stats {
+			uint64_t packets;
+			uint64_t bytes;
+			uint64_t notIP; // Unknown link type, ARP, etc.
+			uint64_t otherPorts;
+			uint64_t tcpGaps; // Lost or out of order segments we resynced past
+			uint64_t messages[Message::COUNT];
+			uint64_t malformed[Message::COUNT];
+		};
+
+		// Without streams, TCP (SideChannel and NetworkTable) is skipped, which
+		// lets a Decoder start partway into a capture
+		explicit Decoder(bool streams = true);
+		void decode(const Capture::Packet& pkt, const MessageHandler& handler);
+		const Stats& getStats() { return stats; }
+
+		// Protocol decoders, usable without a capture
+		static bool decodeDS(narf::ByteReader r, Message& msg);
+		static bool decodeRoboRIO(narf::ByteReader r, Message& msg);
+		static bool decodeFMS_DS(narf::ByteReader r, Message& msg);
+		static bool decodeDS_FMS(narf::ByteReader r, Message& msg);
+
+	private:
+		struct FlowKey {
+			uint8_t src[16];
+			uint8_t dst[16];
+			uint16_t srcPort;
+			uint16_t dstPort;
+			bool operator==(const FlowKey& o) const;
+		};
+		struct FlowHash {
+			size_t operator()(const FlowKey& k) const;
+		};
+		struct Flow {
+			bool synced;
+			uint32_t nextSeq;
+			std::vector<uint8_t> buf;
+			size_t start; // Consumed bytes at the front of buf
+			std::unordered_map<uint16_t, uint8_t> ntTypes; // NetworkTable entry id -> type
+		};
+
+		Stats stats;
+		bool streams;
+		std::unordered_map<FlowKey, Flow, FlowHash> flows;
+
+		void decodeIP(narf::ByteReader r, uint64_t ns, const MessageHandler& handler);
+		void decodeUDP(narf::ByteReader r, const FlowKey& key, uint64_t ns, const MessageHandler& handler);
+		void decodeTCP(narf::ByteReader r, FlowKey& key, uint64_t ns, const MessageHandler& handler);
+		void emit(Message& msg, const MessageHandler& handler);
+
+		// Stream protocols: return bytes consumed, 0 if the message isn't all there yet
+		size_t decodeSideChannel(const FlowKey& key, const uint8_t* data, size_t size, uint64_t ns, const MessageHandler& handler);
+		size_t decodeNetworkTable(const FlowKey& key, Flow& flow, const uint8_t* data, size_t size, uint64_t ns, const MessageHandler& handler);
+		static size_t ntValueSize(narf::ByteReader r, uint8_t type);
+};
+
+std::string formatMessage(const Message& msg);
+
+#endif /* _FRC_H_ */
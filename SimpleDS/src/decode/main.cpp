@@ -0,0 +1,136 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "capture.h"
+#include "frc.h"
+#include "analyzer.h"
+#include "enums.h"
+#include "narf/ringfile.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#define STDOUT_BUFFER (1 << 20)
+#define REC_MIN_SIZE (1 << 20)
+
+void printUsage(const char* name) {
+	printf("Usage: %s [-h] [-q] [--rec file] [--teams [-j threads]] capture.pcap\n", name);
+	printf("  -q         : Only print the summary\n");
+	printf("  --rec file : Also write DS and roboRIO packets to a flight recording,\n");
+	printf("               which SimpleDS can --dump or --replay\n");
+	printf("  --teams    : Summarize each robot (loss, trip time, brownouts, CPU, CAN)\n");
+	printf("               instead of printing packets, using -j threads (default: all cores)\n");
+}
+
+int analyze(const std::string& capFile, unsigned threads) {
+	Analyzer analyzer(threads);
+	if (!analyzer.run(capFile)) {
+		return 1;
+	}
+	analyzer.print(stdout);
+	double secs = analyzer.getIndexSecs() + analyzer.getDecodeSecs();
+	fprintf(stderr, "%s: %llu packets in %zu chunks, %.3f s (index %.3f s, decode %.3f s), %.0f packets/s\n", capFile.c_str(),
+			(unsigned long long)analyzer.getPackets(), analyzer.getChunks(), secs, analyzer.getIndexSecs(),
+			analyzer.getDecodeSecs(), secs > 0 ? (double)analyzer.getPackets() / secs : 0);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	bool quiet = false;
+	bool teams = false;
+	unsigned threads = 0;
+	std::string recFile;
+	std::string capFile;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-h" || arg == "--help") {
+			printUsage(argv[0]);
+			return 0;
+		} else if (arg == "-q" || arg == "--summary") {
+			quiet = true;
+		} else if (arg == "--teams") {
+			teams = true;
+		} else if (arg == "-j" && i + 1 < argc) {
+			threads = (unsigned)atoi(argv[++i]);
+		} else if (arg == "--rec" && i + 1 < argc) {
+			recFile = argv[++i];
+		} else if (capFile.empty()) {
+			capFile = arg;
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (capFile.empty()) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (teams) {
+		return analyze(capFile, threads);
+	}
+
+	Capture cap;
+	if (!cap.open(capFile)) {
+		return 1;
+	}
+
+	narf::RingFile recorder;
+	if (!recFile.empty()) {
+		// The payloads are always smaller than the capture they came out of
+		size_t size = cap.size() * 2 > REC_MIN_SIZE ? cap.size() * 2 : REC_MIN_SIZE;
+		remove(recFile.c_str()); // Start a fresh recording rather than appending to an old one
+		if (!recorder.open(recFile, size)) {
+			printf("Couldn't open recording %s\n", recFile.c_str());
+			return 1;
+		}
+	}
+
+	// Printing is most of the work, so don't let stdio flush every line
+	static char outBuf[STDOUT_BUFFER];
+	setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+
+	Decoder decoder;
+	MessageHandler handler = [&](const Message& msg) {
+		if (recorder.isOpen() && (msg.type == Message::DS || msg.type == Message::ROBORIO)) {
+			recorder.append(msg.type == Message::DS ? TO_ROBOT : FROM_ROBOT, msg.ns, msg.raw, msg.rawSize);
+		}
+		if (!quiet) {
+			auto s = formatMessage(msg);
+			s += '\n';
+			fwrite(s.data(), 1, s.size(), stdout);
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	Capture::Packet pkt;
+	while (cap.next(pkt)) {
+		decoder.decode(pkt, handler);
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fflush(stdout);
+
+	auto& stats = decoder.getStats();
+	fprintf(stderr, "%s: %s, %llu packets, %llu bytes in %.3f s (%.0f packets/s, %.1f MB/s)\n", capFile.c_str(),
+			cap.isNG() ? "pcapng" : "pcap", (unsigned long long)stats.packets, (unsigned long long)stats.bytes,
+			secs, secs > 0 ? (double)stats.packets / secs : 0, secs > 0 ? (double)stats.bytes / secs / 1e6 : 0);
+	if (cap.isTruncated()) {
+		fprintf(stderr, "  Capture is truncated or corrupt at offset %zu\n", cap.tell());
+	}
+	for (int i = 0; i < Message::COUNT; i++) {
+		if (stats.messages[i]) {
+			fprintf(stderr, "  %-12s : %llu (%llu malformed)\n", Message::typeNames[i],
+					(unsigned long long)stats.messages[i], (unsigned long long)stats.malformed[i]);
+		}
+	}
+	fprintf(stderr, "  Not IP       : %llu\n", (unsigned long long)stats.notIP);
+	fprintf(stderr, "  Other ports  : %llu\n", (unsigned long long)stats.otherPorts);
+	fprintf(stderr, "  TCP gaps     : %llu\n", (unsigned long long)stats.tcpGaps);
+	return 0;
+}
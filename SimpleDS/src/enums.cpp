@@ -9,3 +9,4 @@
 std::string allianceNames[2] = {"Red", "Blue"};
 std::string modeNames[3] = {"TeleOp", "Test", "Auton"};
 
+std::string directionNames[2] = {"Out", "In "};
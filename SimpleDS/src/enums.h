@@ -15,4 +15,8 @@ extern std::string allianceNames[2];
 enum Mode {TELEOP, TEST, AUTON};
 extern std::string modeNames[3];
 
+// Record types in the flight recorder
+enum Direction {TO_ROBOT, FROM_ROBOT};
+extern std::string directionNames[2];
+
 #endif /* _ENUMS_H_ */
@@ -25,7 +25,7 @@ int getJSfromGUID(std::string guid) {
 	return -1;
 }
 
-Joystick::Joystick() : js(nullptr), device_idx(-1) {
+Joystick::Joystick() : js(nullptr), haptic(nullptr), device_idx(-1) {
 	close();
 }
 
@@ -37,7 +37,7 @@ Joystick::Joystick(std::string guid) : Joystick() {
 	}
 }
 
-Joystick::Joystick(int idx) : js(nullptr), device_idx(idx) {
+Joystick::Joystick(int idx) : js(nullptr), haptic(nullptr), device_idx(idx) {
 	open(idx);
 }
 
@@ -53,9 +53,10 @@ void Joystick::open(int idx) {
 		guid = getJSGUID(idx);
 		name = std::string(SDL_JoystickName(js));
 		config->setString(std::string("Joysticks.") + guid, name);
-		axes.resize(SDL_JoystickNumAxes(js));
-		buttons.resize(SDL_JoystickNumButtons(js));
-		hats.resize(SDL_JoystickNumHats(js));
+		state.numAxes = (uint8_t)std::min(std::max(SDL_JoystickNumAxes(js), 0), JS_MAX_AXES);
+		state.numButtons = (uint8_t)std::min(std::max(SDL_JoystickNumButtons(js), 0), JS_MAX_BUTTONS);
+		state.numHats = (uint8_t)std::min(std::max(SDL_JoystickNumHats(js), 0), JS_MAX_HATS);
+		sample(); // Events keep it current from here on
 #ifndef SDL_HAPTIC_DISABLED
 		haptic = SDL_HapticOpenFromJoystick(js);
 		effectID = -1;
@@ -91,11 +92,10 @@ void Joystick::close() {
 		SDL_JoystickClose(js);
 	}
 	name = "---";
-	axes.clear();
-	buttons.clear();
-	hats.clear();
+	memset(&state, 0, sizeof(state));
 	memset(outputs, 0, sizeof(outputs));
 	memset(rumble, 0, sizeof(rumble));
+	memset(applied, 0, sizeof(applied));
 }
 
 int16_t Joystick::convertHat(uint8_t h) {
@@ -118,78 +118,120 @@ int16_t Joystick::convertHat(uint8_t h) {
 	return (int)((std::atan2(x, y) * 180 / M_PI + 360)) % 360; */
 }
 
-void Joystick::update() {
-	if (js) {
-		for (uint8_t i = 0; i < axes.size(); i++) {
-			axes[i] = (int8_t)(SDL_JoystickGetAxis(js, i) / 256);
+void Joystick::sample() {
+	int16_t raw[JS_MAX_AXES];
+	for (uint8_t i = 0; i < state.numAxes; i++) {
+		raw[i] = SDL_JoystickGetAxis(js, i);
+	}
+	narf::quantize16to8(raw, state.axes, state.numAxes);
+	memset(state.buttons, 0, sizeof(state.buttons));
+	for (uint8_t i = 0; i < state.numButtons; i++) {
+		if (SDL_JoystickGetButton(js, i)) {
+			state.buttons[i / 8] = (uint8_t)(state.buttons[i / 8] | (1 << (i % 8)));
 		}
-		for (uint8_t i = 0; i < buttons.size(); i++) {
-			buttons[i] = SDL_JoystickGetButton(js, i);
+	}
+	for (uint8_t i = 0; i < state.numHats; i++) {
+		state.hats[i] = convertHat(SDL_JoystickGetHat(js, i));
+	}
+}
+
+void Joystick::update(narf::Histogram& hapticTime) {
+#ifndef SDL_HAPTIC_DISABLED
+	if (!haptic || effectID < 0 || (rumble[0] == applied[0] && rumble[1] == applied[1])) {
+		return;
+	}
+	// Anything newer that comes in before then replaces this value
+	auto start = std::chrono::steady_clock::now();
+	if (start - lastHaptic < HAPTIC_INTERVAL) {
+		return;
+	}
+	effect.leftright.large_magnitude = rumble[0];
+	effect.leftright.small_magnitude = rumble[1];
+	SDL_HapticUpdateEffect(haptic, effectID, &effect);
+	lastHaptic = std::chrono::steady_clock::now();
+	hapticTime.add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(lastHaptic - start).count());
+	applied[0] = rumble[0];
+	applied[1] = rumble[1];
+#endif
+}
+
+SDL_JoystickID Joystick::getInstanceID() {
+	return js ? SDL_JoystickInstanceID(js) : -1;
+}
+
+bool Joystick::handleEvent(const SDL_Event& e, int64_t at, uint32_t sent) {
+	switch (e.type) {
+		case SDL_JOYAXISMOTION: {
+			// Axes report far finer steps than the packet carries
+			int8_t v = (int8_t)(e.jaxis.value / 256);
+			if (e.jaxis.axis >= state.numAxes || state.axes[e.jaxis.axis] == v) {
+				return false;
+			}
+			state.axes[e.jaxis.axis] = v;
+			break;
 		}
-		for (uint8_t i = 0; i < buttons.size(); i++) {
-			hats[i] = convertHat(SDL_JoystickGetHat(js, i));
+		case SDL_JOYBUTTONDOWN:
+		case SDL_JOYBUTTONUP: {
+			uint8_t i = e.jbutton.button;
+			if (i >= state.numButtons) {
+				return false;
+			}
+			uint8_t bit = (uint8_t)(1 << (i % 8));
+			uint8_t v = (e.jbutton.state == SDL_PRESSED) ? bit : 0;
+			if ((state.buttons[i / 8] & bit) == v) {
+				return false;
+			}
+			state.buttons[i / 8] = (uint8_t)((state.buttons[i / 8] & ~bit) | v);
+			break;
 		}
-#ifndef SDL_HAPTIC_DISABLED
-		if (haptic && effectID >= 0 && (std::chrono::system_clock::now() - lastRumble < std::chrono::seconds(1))) {
-			effect.leftright.large_magnitude = rumble[0];
-			effect.leftright.small_magnitude = rumble[1];
-			SDL_HapticUpdateEffect(haptic, effectID, &effect);
+		case SDL_JOYHATMOTION: {
+			int16_t v = convertHat(e.jhat.value);
+			if (e.jhat.hat >= state.numHats || state.hats[e.jhat.hat] == v) {
+				return false;
+			}
+			state.hats[e.jhat.hat] = v;
+			break;
 		}
-#endif
+		default:
+			return false;
+	}
+	if (state.pendingSince == 0 || state.events == sent) {
+		state.pendingSince = at;
 	}
+	state.events++;
+	return true;
 }
 
 int8_t Joystick::getAxis(int idx) {
-	return axes[idx];
+	return state.axes[idx];
 }
 
 std::vector<int8_t> Joystick::getAxes() {
-	return axes;
+	return std::vector<int8_t>(state.axes, state.axes + state.numAxes);
 }
 
 bool Joystick::getButton(int idx) {
-	return buttons[idx];
+	return (state.buttons[idx / 8] >> (idx % 8)) & 1;
 }
 
 std::vector<bool> Joystick::getButtons() {
-	return buttons;
+	std::vector<bool> v(state.numButtons);
+	for (uint8_t i = 0; i < state.numButtons; i++) {
+		v[i] = getButton(i);
+	}
+	return v;
 }
 
 int16_t Joystick::getHat(int idx) {
-	return hats[idx];
+	return state.hats[idx];
 }
 
 std::vector<int16_t> Joystick::getHats() {
-	return hats;
-}
-
-std::string Joystick::makePacket() {
-	narf::ByteStream s;
-	s.write((uint8_t)0x00);
-	s.write((uint8_t)0x0c); // Size, will overwrite when done
-	s.write((uint8_t)axes.size());
-	for (auto a : axes) {
-		s.write(a);
-	}
-	uint8_t numButtons = (uint8_t)buttons.size();
-	s.write(numButtons);
-	uint16_t b = 0;
-	for (uint8_t i = 0; i < numButtons; i++) {
-		b = (uint16_t)((b << 1) | getButton(numButtons - i - 1));
-	}
-	s.write(b, BE);
-	s.write((uint8_t)hats.size());
-	for (auto h : hats) {
-		s.write(h);
-	}
-	auto v = s.str();
-	v[0] = (uint8_t)(v.size() - 1);
-	return v;
+	return std::vector<int16_t>(state.hats, state.hats + state.numHats);
 }
 
 void Joystick::setRumble(uint16_t val, Rumble side) {
 	rumble[side] = val;
-	lastRumble = std::chrono::system_clock::now();
 }
 
 void Joystick::setRumble(uint16_t left, uint16_t right) {
@@ -229,11 +271,11 @@ std::string Joystick::toString() {
 	for (auto v : getHats()) {
 		out += narf::util::format("%d", v);
 	}
+	out += narf::util::format("   Rumble: %d %d", rumble[0], rumble[1]);
 	out += "\n Outputs : ";
 	for (int i = 0; i < 32; i++) {
 		out += outputs[i] ? "1" : "0";
 	}
-	out += narf::util::format("\n Rumble  : %5d %5d", rumble[0], rumble[1]);
 
 	return out;
 }
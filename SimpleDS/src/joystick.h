@@ -10,13 +10,40 @@
 #include "config.h"
 #include "narf/format.h"
 #include "narf/tokenize.h"
-#include "narf/bytestream.h"
+#include "narf/bytewriter.h"
+#include "narf/quantize.h"
+#include "narf/histogram.h"
 #include <cmath>
 #include <chrono>
 #include <vector>
+#include <algorithm>
 #include <SDL2/SDL.h>
 
+// Buttons go up to what the count byte holds. Axes and hats are capped so
+// a block with all three maxed out still fits its one byte length, and six
+// of them fit in a packet.
+#define JS_MAX_AXES 32
+#define JS_MAX_BUTTONS 255
+#define JS_MAX_HATS 32
+#define JS_BLOCK_MAX (1 + 1 + 1 + JS_MAX_AXES + 1 + (JS_MAX_BUTTONS + 7) / 8 + 1 + 2 * JS_MAX_HATS) // Including the length byte
+static_assert(JS_BLOCK_MAX - 1 <= 255, "Joystick block length has to fit in a byte");
+#define HAPTIC_INTERVAL std::chrono::milliseconds(50) // Most often rumble is written to a device
+
 class Joystick {
+	public:
+		// Everything that goes in a packet, fixed size so it can be copied
+		// between threads without allocating
+		struct State {
+			uint8_t numAxes;
+			uint8_t numButtons;
+			uint8_t numHats;
+			int8_t axes[JS_MAX_AXES];
+			uint8_t buttons[(JS_MAX_BUTTONS + 7) / 8]; // Button i is bit i % 8 of byte i / 8
+			int16_t hats[JS_MAX_HATS];
+			uint32_t events; // Input events seen so far
+			int64_t pendingSince; // steady_clock ns of the oldest event not sent yet, 0 for none
+		};
+
 	private:
 		int device_idx;
 		std::string guid;
@@ -24,14 +51,14 @@ class Joystick {
 		SDL_Haptic* haptic;
 		SDL_HapticEffect effect;
 		int effectID;
-		std::vector<int8_t> axes;
-		std::vector<bool> buttons;
-		std::vector<int16_t> hats;
+		State state;
 		bool outputs[32];
-		uint16_t rumble[2];
-		std::chrono::system_clock::time_point lastRumble;
+		uint16_t rumble[2]; // What the robot wants
+		uint16_t applied[2]; // What the device was last told
+		std::chrono::steady_clock::time_point lastHaptic;
 		std::string name;
 		static int16_t convertHat(uint8_t h);
+		void sample();
 	public:
 		enum Rumble { LEFT, RIGHT };
 		Joystick();
@@ -40,7 +67,9 @@ class Joystick {
 		~Joystick();
 		void open(int idx);
 		void close();
-		void update();
+		// Writes rumble to the device if it changed, at most every
+		// HAPTIC_INTERVAL. Time spent in the write goes in hapticTime.
+		void update(narf::Histogram& hapticTime);
 		bool isValid() { return js != nullptr; }
 		int getDeviceIdx() { return device_idx; }
 		std::string getName() { return name; }
@@ -50,7 +79,14 @@ class Joystick {
 		std::vector<bool> getButtons();
 		int16_t getHat(int idx);
 		std::vector<int16_t> getHats();
-		std::string makePacket();
+		SDL_JoystickID getInstanceID();
+		// Apply an axis, button or hat event that arrived at the given
+		// steady_clock ns. sent is how many of our events the DS has put in a
+		// packet so far. Returns true if the state changed.
+		bool handleEvent(const SDL_Event& e, int64_t at, uint32_t sent);
+		void clearPending() { state.pendingSince = 0; }
+		const State& getState() { return state; }
+		static void makePacket(const State& state, narf::ByteWriter& out);
 		void setRumble(uint16_t val, Rumble side);
 		void setRumble(uint16_t left, uint16_t right);
 		uint16_t getRumble(Rumble side);
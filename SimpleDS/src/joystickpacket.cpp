@@ -0,0 +1,33 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "joystick.h"
+
+// Kept apart from the rest of Joystick so the tests can build it without
+// linking SDL
+void Joystick::makePacket(const State& state, narf::ByteWriter& out) {
+	size_t start = out.tell();
+	out.write((uint8_t)0x00); // Size, will overwrite when done
+	out.write((uint8_t)0x0c);
+	out.write(state.numAxes);
+	out.write(state.axes, state.numAxes);
+	// ceil(numButtons / 8) bytes, most significant first, so the last
+	// byte holds buttons 0-7 and unused high bits are zero
+	out.write(state.numButtons);
+	int top = (state.numButtons + 7) / 8 - 1;
+	if (top >= 0) {
+		uint8_t used = (uint8_t)(state.numButtons % 8 ? (1 << (state.numButtons % 8)) - 1 : 0xff);
+		out.write((uint8_t)(state.buttons[top] & used));
+	}
+	for (int i = top - 1; i >= 0; i--) {
+		out.write(state.buttons[i]);
+	}
+	out.write(state.numHats);
+	for (uint8_t i = 0; i < state.numHats; i++) {
+		out.write(state.hats[i], BE);
+	}
+	out.patch(start, (uint8_t)(out.tell() - start - 1));
+}
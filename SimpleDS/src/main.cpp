@@ -10,11 +10,14 @@
 #include "narf/tokenize.h"
 #include "narf/embed.h"
 #include "narf/format.h"
+#include "narf/ringfile.h"
 #include "screen.h"
 #include "version.h"
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
@@ -37,7 +40,104 @@ std::string getOpt(const std::string arg) {
 }
 
 void printUsage() {
-	printf("Usage: %s [-h] [-V] [-c config] [teamNum]\n", args[0]);
+	printf("Usage: %s [-h] [-V] [-c config] [--record file] [--dump file] [--replay file [--speed N|max]] [--headless] [teamNum]\n", args[0]);
+}
+
+// Print a flight recorder file, oldest packet first
+int dumpRecording(const std::string& filename) {
+	narf::RingFile rf;
+	if (!rf.openReadOnly(filename)) {
+		printf("Couldn't open recording %s\n", filename.c_str());
+		return 1;
+	}
+	uint64_t first = 0, prev = 0;
+	size_t count = 0;
+	const int64_t maxGap = std::chrono::duration_cast<std::chrono::nanoseconds>(RECORD_MAX_GAP).count();
+	rf.forEach([&](const narf::RingFile::Record& r) {
+		// Times are from the start of each run; a stamp going backwards or
+		// far ahead means a new one
+		int64_t step = (int64_t)(r.stamp - prev);
+		if (count++ == 0 || step < 0 || step > maxGap) {
+			if (count > 1) {
+				printf("-- clock jumped %+.3f s --\n", (double)step / 1e9);
+			}
+			first = r.stamp;
+		}
+		prev = r.stamp;
+		printf("%12.6f %s:", (double)(int64_t)(r.stamp - first) / 1e9, r.type < 2 ? directionNames[r.type].c_str() : "???");
+		for (uint32_t i = 0; i < r.size; i++) {
+			printf(" %02x", r.data[i]);
+		}
+		printf("\n");
+	});
+	printf("%zu packets\n", count);
+	return 0;
+}
+
+// One line summary, used for the window title and headless status
+std::string statusText(uint16_t teamNum, DS* ds) {
+	std::string s = narf::util::format("Team %d", teamNum);
+	if (ds->isConnected()) {
+		auto rio = ds->getRoboRIO();
+		s += " - ";
+		if (rio->getEStop()) {
+			s += "E-Stopped";
+		} else {
+			s += narf::util::format("%s %s", modeNames[rio->getMode()].c_str(), rio->getEnable() ? "Enabled" : "Disabled");
+		}
+		s += narf::util::format(" - %s %d", allianceNames[ds->getAlliance()].c_str(), ds->getPosition());
+		if (!rio->getCode()) {
+			s += " - No Code";
+		}
+	} else {
+		s += ds->wasRefused() ? " - No Comms (refused)" : " - No Comms";
+	}
+	return s;
+}
+
+// Run without a window: only joysticks and the DS, with status on stdout.
+// Ends on SIGINT/SIGTERM (SDL turns them into SDL_QUIT) or when a replay finishes.
+int runHeadless(uint16_t teamNum, DS* ds, std::future<void>& runner) {
+	int32_t interval = config->getInt32("DS.statusInterval");
+	auto nextStatus = std::chrono::steady_clock::now();
+	bool quit = false;
+	SDL_Event e;
+	while (!quit) {
+		while (SDL_PollEvent(&e) != 0) {
+			if (e.type == SDL_QUIT) {
+				quit = true;
+			} else if (e.type == SDL_JOYDEVICEREMOVED || e.type == SDL_JOYDEVICEADDED) {
+				ds->setEnable(false);
+				ds->loadJoysticks();
+			} else if (e.type == SDL_JOYAXISMOTION || e.type == SDL_JOYHATMOTION || e.type == SDL_JOYBUTTONDOWN || e.type == SDL_JOYBUTTONUP) {
+				ds->handleInput(e);
+			}
+		}
+		if (runner.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			quit = true;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (interval > 0 && (now >= nextStatus || quit)) {
+			nextStatus = now + std::chrono::milliseconds(interval);
+			auto& rtt = ds->getRTT();
+			auto& echoes = ds->getEchoes();
+			printf("%s - %.2f V - rtt p50 %d us p99 %d us - lost %llu (%u/s)\n", statusText(teamNum, ds).c_str(),
+					ds->isConnected() ? ds->getRoboRIO()->getBattery() : 0.0f, (int)rtt.percentile(50), (int)rtt.percentile(99),
+					(unsigned long long)echoes.lost(), ds->getLossRate());
+			fflush(stdout);
+		}
+
+		ds->updateJoysticks();
+		SDL_WaitEventTimeout(nullptr, 25); // Back as soon as there's input
+	}
+
+	ds->saveJoysticks();
+	ds->stop();
+	runner.wait();
+	ds->dumpStats();
+	SDL_Quit();
+	return 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -49,7 +149,13 @@ int main(int argc, char* argv[]) {
 	printf("\nAuthors: " VERSION_AUTHORS "\n");
 
 	args = std::vector<const char*>(argv, argv + argc);
-	int offset = 1;
+
+	// The team number is the first argument that isn't an option or an option's value
+	static const std::vector<std::string> valueOpts = {"-c", "--config", "--record", "--dump", "--replay", "--speed"};
+	size_t offset = 1;
+	while (offset < args.size() && args[offset][0] == '-') {
+		offset += (std::find(valueOpts.begin(), valueOpts.end(), args[offset]) != valueOpts.end()) ? 2 : 1;
+	}
 
 	std::string configFile = "./simpleds.conf";
 	if (hasOpt("-c") || hasOpt("--config")) {
@@ -57,7 +163,6 @@ int main(int argc, char* argv[]) {
 		if (configFile.size() == 0) {
 			configFile = getOpt("--config");
 		}
-		offset += 2;
 	}
 	config = new Config(configFile);
 	if (config->loaded) {
@@ -84,14 +189,33 @@ int main(int argc, char* argv[]) {
 		printf(" -v, --verbose   Output debugging information\n");
 		printf(" -V, --version   Prints version info and exits\n");
 		printf(" -c, --config    Sets the config file to use [default: ./simpleds.conf]\n");
+		printf(" --record file   Records traffic to file instead of DS.recordFile\n");
+		printf(" --dump file     Prints a flight recording and exits\n");
+		printf(" --replay file   Plays a flight recording back through the DS instead of talking to a robot\n");
+		printf(" --speed N|max   Replay speed multiplier; max replays without a window and prints throughput [default: 1]\n");
+		printf(" --headless      Runs without a window, printing status every DS.statusInterval ms\n");
 		printf(" teamNum         The team number to use, must be provided here or in configuration file\n");
 		return 0;
 	}
 
-	if (teamNum == 0 && args.begin() + offset == args.end()) { // We're out of arguments
+	if (hasOpt("--dump")) {
+		return dumpRecording(getOpt("--dump"));
+	}
+
+	std::string replayFile = getOpt("--replay");
+	double replaySpeed = 1.0;
+	if (hasOpt("--speed")) {
+		auto speed = getOpt("--speed");
+		replaySpeed = (speed == "max") ? 0.0 : std::strtod(speed.c_str(), nullptr);
+	}
+	bool replaying = replayFile.size() > 0;
+
+	if (replaying) {
+		// Nothing goes to a robot, so the team number is only for display
+	} else if (teamNum == 0 && offset >= args.size()) { // We're out of arguments
 		printUsage();
 		return 1;
-	} else {
+	} else if (offset < args.size()) {
 		char* endptr;
 		uint16_t argTeamNum = (uint16_t)std::strtol(args[offset], &endptr, 10);
 
@@ -107,25 +231,89 @@ int main(int argc, char* argv[]) {
 
 	printf("Team Number: %d\n", teamNum);
 
-	bool quit = false;
-	SDL_Event e;
-
-	auto gui = new GUI();
-	if (!gui->isValid()) {
-		return 1;
+	if (!replaying) {
+		config->setInt32("DS.team", teamNum);
 	}
-
-	config->setInt32("DS.team", teamNum);
 	config->initInt32("DS.alliance", Alliance::RED);
 	config->initInt32("DS.position", 1);
+	config->initString("DS.statsFile", "./simpleds-stats.ini");
+	config->initString("DS.recordFile", "./simpleds.rec");
+	config->initInt32("DS.recordSize", 16); // MiB, 0 turns the recorder off
+	config->initInt32("DS.statusInterval", 1000); // ms, headless only
+	config->initString("DS.robotAddress", ""); // Tried along with mDNS, 10.TE.AM.2 and USB
+	config->initString("DS.addressCache", "./simpleds-robot.cache"); // Where the roboRIO last answered from
+	config->initInt32("DS.lossThreshold", 10); // Control periods (20 ms) without status before comms count as lost
+	config->initInt32("DS.connectUdp", 1); // connect() to the roboRIO once it answers: no stray packets, and a refusal drops comms at once
+	config->initInt32("DS.rtCore", -1); // Core for the control loop alone, -1 to leave it to the OS
+	config->initInt32("DS.rtPriority", 0); // SCHED_FIFO priority 1-99 for the control loop, 0 for normal
+	config->initInt32("DS.lockMemory", 0); // mlockall so the control loop can't be paged out
+
+	if (replaying && replaySpeed <= 0) {
+		DS::initialize(teamNum, true);
+		return DS::getInstance()->replay(replayFile, 0.0) ? 0 : 1;
+	}
+
+	// Before SDL or the DS start any threads, so they inherit staying off the control loop's core
+	int32_t rtCore = config->getInt32("DS.rtCore");
+	if (rtCore >= 0 && rtCore >= getCoreCount()) {
+		printf("DS.rtCore %d doesn't exist, there are %d cores\n", rtCore, getCoreCount());
+		rtCore = -1;
+	}
+	if (rtCore >= 0 && !avoidCore(rtCore)) {
+		rtCore = -1; // Pinning only helps if everything else can be kept off that core
+	}
+	if (config->getInt32("DS.lockMemory") != 0 && lockMemory()) {
+		printf("Memory locked\n");
+	}
+
+	bool headless = hasOpt("--headless");
+	GUI* gui = nullptr;
+	if (headless) {
+		uint32_t flags = SDL_INIT_JOYSTICK;
+#ifndef SDL_HAPTIC_DISABLED
+		flags |= SDL_INIT_HAPTIC;
+#endif
+		if (SDL_Init(flags) < 0) {
+			printf("Error: Failed SDL_Init: %s\n", SDL_GetError());
+			return 1;
+		}
+	} else {
+		gui = new GUI();
+		if (!gui->isValid()) {
+			return 1;
+		}
+	}
 
-	DS::initialize(teamNum);
+	DS::initialize(teamNum, replaying);
 	auto ds = DS::getInstance();
 
+	if (!replaying) {
+		auto recordFile = hasOpt("--record") ? getOpt("--record") : config->getString("DS.recordFile");
+		int32_t recordSize = config->getInt32("DS.recordSize");
+		if (hasOpt("--record") && recordSize <= 0) {
+			recordSize = 16;
+		}
+		if (recordSize > 0) {
+			ds->openRecorder(recordFile, (size_t)recordSize << 20);
+		}
+	}
+
+	ds->setRealtime(rtCore, config->getInt32("DS.rtPriority"));
+	auto runner = std::async(std::launch::async, [=]() {
+		if (replaying) {
+			ds->replay(replayFile, replaySpeed);
+		} else {
+			ds->run();
+		}
+	});
+	if (headless) {
+		return runHeadless(teamNum, ds, runner);
+	}
+
 	enum GUIMode { MAIN, INFO, JOYSTICKS, CONTROL, HELP, COUNT };
 	GUIMode mode = GUIMode::MAIN;
-
-	auto runner = std::async(std::launch::async, &DS::run, ds);
+	bool quit = false;
+	SDL_Event e;
 	std::map<GUIMode, Screen*> screens;
 	screens[MAIN] = new ScreenMain();
 	screens[INFO] = new ScreenInfo();
@@ -137,9 +325,13 @@ int main(int argc, char* argv[]) {
 		while (gui->pollEvent(&e) != 0) {
 			if (e.type == SDL_QUIT) {
 				quit = true;
+			} else if (e.type == SDL_WINDOWEVENT || e.type == SDL_RENDER_TARGETS_RESET) {
+				gui->invalidate(); // Exposed, resized or lost the target texture
 			} else if (e.type == SDL_JOYDEVICEREMOVED || e.type == SDL_JOYDEVICEADDED) {
 				ds->setEnable(false);
 				ds->loadJoysticks();
+			} else if (e.type == SDL_JOYAXISMOTION || e.type == SDL_JOYHATMOTION || e.type == SDL_JOYBUTTONDOWN || e.type == SDL_JOYBUTTONUP) {
+				ds->handleInput(e);
 			} else if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
 				auto key = e.key.keysym;
 				if (key.sym == SDLK_e) {
@@ -148,6 +340,8 @@ int main(int argc, char* argv[]) {
 					ds->setEnable(false);
 				} else if (key.sym == SDLK_0) {
 					ds->setEStop();
+				} else if (key.sym == SDLK_d) {
+					ds->dumpStats();
 				} else if (key.sym == SDLK_q) {
 					quit = true;
 				} else if (key.sym == SDLK_r) {
@@ -187,26 +381,10 @@ int main(int argc, char* argv[]) {
 			gui->render();
 		}
 
-		std::string s = narf::util::format("Team %d", teamNum);
-		if (ds->isConnected()) {
-			auto rio = ds->getRoboRIO();
-			s += " - ";
-			if (rio->getEStop()) {
-				s += "E-Stopped";
-			} else {
-				s += narf::util::format("%s %s", modeNames[rio->getMode()].c_str(), rio->getEnable() ? "Enabled" : "Disabled");
-			}
-			s += narf::util::format(" - %s %d", allianceNames[ds->getAlliance()].c_str(), ds->getPosition());
-			if (!rio->getCode()) {
-				s += " - No Code";
-			}
-		} else {
-			s += " - No Comms";
-		}
-		gui->setTitle(s);
+		gui->setTitle(statusText(teamNum, ds));
 
 		ds->updateJoysticks();
-		SDL_Delay(25);
+		gui->waitEvent(25);
 	}
 
 	ds->saveJoysticks();
@@ -0,0 +1,170 @@
+/*
+ * Non-owning byte buffer reader
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include "narf/bytereader.h"
+
+narf::ByteReader::ByteReader() : data_(nullptr), size_(0), pos(0), overran_(false), default_(Endian::LITTLE) { }
+
+narf::ByteReader::ByteReader(const void* data, size_t size, Endian defaultEndian /*= Endian::LITTLE*/) :
+	data_(static_cast<const uint8_t*>(data)), size_(data ? size : 0), pos(0), overran_(false),
+	default_(defaultEndian == Endian::DEFAULT ? Endian::LITTLE : defaultEndian) { }
+
+bool narf::ByteReader::read(void* v, ByteStream::Type type, Endian endian /*= Endian::DEFAULT*/) {
+	assert(v != nullptr);
+	size_t size;
+	switch (type) {
+		case ByteStream::Type::U16: case ByteStream::Type::I16: size = 2; break;
+		case ByteStream::Type::U32: case ByteStream::Type::I32: case ByteStream::Type::FLOAT: size = 4; break;
+		case ByteStream::Type::U64: case ByteStream::Type::I64: case ByteStream::Type::DOUBLE: size = 8; break;
+		default: size = 1; break;
+	}
+	if (size > bytesLeft()) {
+		overran_ = true;
+		pos = size_;
+		return false;
+	}
+
+	if (endian == Endian::DEFAULT) {
+		endian = default_;
+	}
+
+	auto vp = static_cast<uint8_t*>(v);
+	for (size_t i = 0; i < size; i++) {
+		vp[i] = data_[pos + (endian == Endian::BIG ? (size - 1 - i) : i)];
+	}
+	pos += size;
+	return true;
+}
+
+bool narf::ByteReader::read(void* v, size_t c) {
+	if (c > bytesLeft()) {
+		memset(v, 0, c);
+		overran_ = true;
+		c = bytesLeft();
+	}
+	if (c) {
+		memcpy(v, data_ + pos, c);
+		pos += c;
+	}
+	return !overran_;
+}
+
+bool narf::ByteReader::read(uint8_t* v) {
+	return read(v, ByteStream::Type::U8);
+}
+
+bool narf::ByteReader::read(int8_t* v) {
+	return read(v, ByteStream::Type::I8);
+}
+
+bool narf::ByteReader::read(uint16_t* v, Endian endian /*= Endian::DEFAULT*/) {
+	return read(v, ByteStream::Type::U16, endian);
+}
+
+bool narf::ByteReader::read(int16_t* v, Endian endian /*= Endian::DEFAULT*/) {
+	return read(v, ByteStream::Type::I16, endian);
+}
+
+bool narf::ByteReader::read(uint32_t* v, Endian endian /*= Endian::DEFAULT*/) {
+	return read(v, ByteStream::Type::U32, endian);
+}
+
+bool narf::ByteReader::read(int32_t* v, Endian endian /*= Endian::DEFAULT*/) {
+	return read(v, ByteStream::Type::I32, endian);
+}
+
+bool narf::ByteReader::read(float* v, Endian endian /*= Endian::DEFAULT*/) {
+	return read(v, ByteStream::Type::FLOAT, endian);
+}
+
+uint8_t narf::ByteReader::readU8() {
+	uint8_t v = 0;
+	read(&v);
+	return v;
+}
+
+int8_t narf::ByteReader::readI8() {
+	int8_t v = 0;
+	read(&v);
+	return v;
+}
+
+uint16_t narf::ByteReader::readU16(Endian endian /*= Endian::DEFAULT*/) {
+	uint16_t v = 0;
+	read(&v, endian);
+	return v;
+}
+
+int16_t narf::ByteReader::readI16(Endian endian /*= Endian::DEFAULT*/) {
+	int16_t v = 0;
+	read(&v, endian);
+	return v;
+}
+
+uint32_t narf::ByteReader::readU32(Endian endian /*= Endian::DEFAULT*/) {
+	uint32_t v = 0;
+	read(&v, endian);
+	return v;
+}
+
+int32_t narf::ByteReader::readI32(Endian endian /*= Endian::DEFAULT*/) {
+	int32_t v = 0;
+	read(&v, endian);
+	return v;
+}
+
+float narf::ByteReader::readFloat(Endian endian /*= Endian::DEFAULT*/) {
+	float v = 0.0f;
+	read(&v, endian);
+	return v;
+}
+
+narf::ByteReader narf::ByteReader::sub(size_t c) {
+	if (c > bytesLeft()) {
+		overran_ = true;
+		c = bytesLeft();
+	}
+	ByteReader r(data_ + pos, c, default_);
+	pos += c;
+	return r;
+}
+
+void narf::ByteReader::seek(size_t newPos) {
+	pos = (newPos > size_) ? size_ : newPos;
+}
+
+void narf::ByteReader::skip(size_t c) {
+	pos = (c > bytesLeft()) ? size_ : (pos + c);
+}
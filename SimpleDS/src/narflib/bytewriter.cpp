@@ -0,0 +1,118 @@
+/*
+ * Fixed-buffer byte writer
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <assert.h>
+
+#include "narf/bytewriter.h"
+
+narf::ByteWriter::ByteWriter(void* data, size_t capacity, Endian defaultEndian /*= Endian::LITTLE*/) :
+	data_(static_cast<uint8_t*>(data)), capacity_(data ? capacity : 0), pos(0), overran_(false),
+	default_(defaultEndian == Endian::DEFAULT ? Endian::LITTLE : defaultEndian) { }
+
+bool narf::ByteWriter::write(const void* data, size_t size) {
+	if (size > bytesLeft()) {
+		overran_ = true;
+		return false;
+	}
+	if (size) {
+		memcpy(data_ + pos, data, size);
+		pos += size;
+	}
+	return true;
+}
+
+bool narf::ByteWriter::write(const void* v, ByteStream::Type type, Endian endian /*= Endian::DEFAULT*/) {
+	assert(v != nullptr);
+	size_t size;
+	switch (type) {
+		case ByteStream::Type::U16: case ByteStream::Type::I16: size = 2; break;
+		case ByteStream::Type::U32: case ByteStream::Type::I32: case ByteStream::Type::FLOAT: size = 4; break;
+		case ByteStream::Type::U64: case ByteStream::Type::I64: case ByteStream::Type::DOUBLE: size = 8; break;
+		default: size = 1; break;
+	}
+	if (size > bytesLeft()) {
+		overran_ = true;
+		return false;
+	}
+
+	if (endian == Endian::DEFAULT) {
+		endian = default_;
+	}
+
+	auto vp = static_cast<const uint8_t*>(v);
+	for (size_t i = 0; i < size; i++) {
+		data_[pos + i] = vp[(endian == Endian::BIG ? (size - 1 - i) : i)];
+	}
+	pos += size;
+	return true;
+}
+
+bool narf::ByteWriter::write(uint8_t v) {
+	return write(&v, ByteStream::Type::U8);
+}
+
+bool narf::ByteWriter::write(int8_t v) {
+	return write(&v, ByteStream::Type::I8);
+}
+
+bool narf::ByteWriter::write(uint16_t v, Endian endian /*= Endian::DEFAULT*/) {
+	return write(&v, ByteStream::Type::U16, endian);
+}
+
+bool narf::ByteWriter::write(int16_t v, Endian endian /*= Endian::DEFAULT*/) {
+	return write(&v, ByteStream::Type::I16, endian);
+}
+
+bool narf::ByteWriter::write(uint32_t v, Endian endian /*= Endian::DEFAULT*/) {
+	return write(&v, ByteStream::Type::U32, endian);
+}
+
+bool narf::ByteWriter::write(int32_t v, Endian endian /*= Endian::DEFAULT*/) {
+	return write(&v, ByteStream::Type::I32, endian);
+}
+
+bool narf::ByteWriter::write(float v, Endian endian /*= Endian::DEFAULT*/) {
+	return write(&v, ByteStream::Type::FLOAT, endian);
+}
+
+bool narf::ByteWriter::patch(size_t at, uint8_t v) {
+	if (at >= pos) {
+		return false;
+	}
+	data_[at] = v;
+	return true;
+}
+
+void narf::ByteWriter::seek(size_t newPos) {
+	pos = (newPos > capacity_) ? capacity_ : newPos;
+}
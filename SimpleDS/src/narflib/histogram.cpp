@@ -0,0 +1,115 @@
+/*
+ * Fixed-bucket histogram
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "narf/histogram.h"
+
+narf::Histogram::Histogram(uint64_t bucketWidth, size_t bucketCount) :
+	width_(bucketWidth ? bucketWidth : 1), buckets_(bucketCount + 1) {
+	reset();
+}
+
+void narf::Histogram::add(uint64_t v) {
+	size_t idx = (size_t)(v / width_);
+	if (idx >= buckets_.size()) {
+		idx = buckets_.size() - 1;
+	}
+	// Only one writer, so plain load/store pairs are enough to keep readers consistent
+	buckets_[idx].store(buckets_[idx].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	sum_.store(sum_.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+	if (v < min_.load(std::memory_order_relaxed)) {
+		min_.store(v, std::memory_order_relaxed);
+	}
+	if (v > max_.load(std::memory_order_relaxed)) {
+		max_.store(v, std::memory_order_relaxed);
+	}
+	count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void narf::Histogram::reset() {
+	for (auto& b : buckets_) {
+		b.store(0, std::memory_order_relaxed);
+	}
+	count_.store(0, std::memory_order_relaxed);
+	sum_.store(0, std::memory_order_relaxed);
+	min_.store(UINT64_MAX, std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+}
+
+bool narf::Histogram::merge(const Histogram& other) {
+	if (other.width_ != width_ || other.buckets_.size() != buckets_.size()) {
+		return false;
+	}
+	if (other.count() == 0) {
+		return true;
+	}
+	for (size_t i = 0; i < buckets_.size(); i++) {
+		buckets_[i].store(bucket(i) + other.bucket(i), std::memory_order_relaxed);
+	}
+	sum_.store(sum_.load(std::memory_order_relaxed) + other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	if (other.min() < min_.load(std::memory_order_relaxed)) {
+		min_.store(other.min(), std::memory_order_relaxed);
+	}
+	if (other.max() > max()) {
+		max_.store(other.max(), std::memory_order_relaxed);
+	}
+	count_.store(count() + other.count(), std::memory_order_relaxed);
+	return true;
+}
+
+uint64_t narf::Histogram::min() const {
+	return count() ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+double narf::Histogram::mean() const {
+	uint64_t c = count();
+	return c ? (double)sum_.load(std::memory_order_relaxed) / (double)c : 0.0;
+}
+
+uint64_t narf::Histogram::percentile(double p) const {
+	uint64_t total = count();
+	if (total == 0) {
+		return 0;
+	}
+	uint64_t target = (uint64_t)((double)total * p / 100.0 + 0.5);
+	if (target == 0) {
+		target = 1;
+	}
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets_.size() - 1; i++) {
+		seen += bucket(i);
+		if (seen >= target) {
+			uint64_t upper = (i + 1) * width_ - 1;
+			return upper < max() ? upper : max();
+		}
+	}
+	return max();
+}
@@ -0,0 +1,95 @@
+/*
+ * Non-owning byte buffer reader
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_BYTEREADER_H
+#define NARF_BYTEREADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "narf/bytestream.h"
+
+namespace narf {
+
+// Non-owning reader over an existing buffer. Unlike ByteStream it never copies
+// the data and never allocates, so it can be used on every received packet.
+// The buffer must outlive the reader.
+class ByteReader {
+public:
+	typedef ByteStream::Endian Endian;
+
+	ByteReader();
+	ByteReader(const void* data, size_t size, Endian defaultEndian = Endian::LITTLE);
+
+	bool read(void* v, ByteStream::Type type, Endian endian = Endian::DEFAULT);
+	bool read(void* v, size_t c);
+	bool read(uint8_t* v);
+	bool read(int8_t* v);
+	bool read(uint16_t* v, Endian endian = Endian::DEFAULT);
+	bool read(int16_t* v, Endian endian = Endian::DEFAULT);
+	bool read(uint32_t* v, Endian endian = Endian::DEFAULT);
+	bool read(int32_t* v, Endian endian = Endian::DEFAULT);
+	bool read(float* v, Endian endian = Endian::DEFAULT);
+	uint8_t readU8();
+	int8_t readI8();
+	uint16_t readU16(Endian endian = Endian::DEFAULT);
+	int16_t readI16(Endian endian = Endian::DEFAULT);
+	uint32_t readU32(Endian endian = Endian::DEFAULT);
+	int32_t readI32(Endian endian = Endian::DEFAULT);
+	float readFloat(Endian endian = Endian::DEFAULT);
+
+	// Split off the next c bytes as their own reader and skip past them.
+	// If fewer than c bytes are left the result is short and overran() is set.
+	ByteReader sub(size_t c);
+
+	void seek(size_t newPos);
+	size_t tell() const { return pos; }
+	void skip(size_t c);
+	size_t bytesLeft() const { return size_ - pos; }
+	size_t size() const { return size_; }
+	const uint8_t* data() const { return data_; }
+	const uint8_t* cur() const { return data_ + pos; }
+
+	// Sticky: set once any read ran past the end of the buffer
+	bool overran() const { return overran_; }
+
+private:
+	const uint8_t* data_;
+	size_t size_;
+	size_t pos;
+	bool overran_;
+	Endian default_;
+};
+
+} // namespace narf
+
+#endif // NARF_BYTEREADER_H
@@ -0,0 +1,89 @@
+/*
+ * Fixed-buffer byte writer
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_BYTEWRITER_H
+#define NARF_BYTEWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "narf/bytestream.h"
+
+namespace narf {
+
+// Writer into a caller-provided, fixed-size buffer. Never allocates; a write
+// that doesn't fit is dropped whole and sets overran() instead of growing.
+class ByteWriter {
+public:
+	typedef ByteStream::Endian Endian;
+
+	ByteWriter(void* data, size_t capacity, Endian defaultEndian = Endian::LITTLE);
+
+	bool write(const void* data, size_t size);
+	bool write(const void* v, ByteStream::Type type, Endian endian = Endian::DEFAULT);
+	bool write(const std::string& data) { return write(data.data(), data.size()); }
+	bool write(uint8_t v);
+	bool write(int8_t v);
+	bool write(uint16_t v, Endian endian = Endian::DEFAULT);
+	bool write(int16_t v, Endian endian = Endian::DEFAULT);
+	bool write(uint32_t v, Endian endian = Endian::DEFAULT);
+	bool write(int32_t v, Endian endian = Endian::DEFAULT);
+	bool write(float v, Endian endian = Endian::DEFAULT);
+
+	// Overwrite a byte that was already written, e.g. a length prefix
+	bool patch(size_t at, uint8_t v);
+
+	void seek(size_t newPos);
+	size_t tell() const { return pos; }
+	size_t size() const { return pos; }
+	size_t capacity() const { return capacity_; }
+	size_t bytesLeft() const { return capacity_ - pos; }
+	void clear() { pos = 0; overran_ = false; }
+
+	uint8_t* data() { return data_; }
+	const uint8_t* data() const { return data_; }
+
+	// Sticky: set once any write didn't fit
+	bool overran() const { return overran_; }
+
+private:
+	uint8_t* data_;
+	size_t capacity_;
+	size_t pos;
+	bool overran_;
+	Endian default_;
+};
+
+} // namespace narf
+
+#endif // NARF_BYTEWRITER_H
@@ -0,0 +1,82 @@
+/*
+ * Fixed-bucket histogram
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_HISTOGRAM_H
+#define NARF_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace narf {
+
+// Fixed-width bucket histogram for non-negative samples (e.g. microseconds).
+// Buckets are allocated once up front; add() never allocates, so it is safe to
+// use from timing-sensitive loops. One thread may add() while others read.
+// Samples past the last bucket are counted in an overflow bucket.
+class Histogram {
+public:
+	Histogram(uint64_t bucketWidth, size_t bucketCount);
+
+	void add(uint64_t v);
+	void reset();
+
+	// Add another histogram's samples into this one. Both need the same
+	// bucket layout; returns false (and changes nothing) if they don't.
+	bool merge(const Histogram& other);
+
+	uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+	uint64_t min() const;
+	uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+	double mean() const;
+
+	// Upper bound of the bucket holding the p-th percentile (0 < p <= 100),
+	// clamped to the largest sample seen
+	uint64_t percentile(double p) const;
+
+	uint64_t bucketWidth() const { return width_; }
+	size_t bucketCount() const { return buckets_.size(); } // includes overflow bucket
+	uint64_t bucket(size_t idx) const { return buckets_[idx].load(std::memory_order_relaxed); }
+
+private:
+	uint64_t width_;
+	std::vector<std::atomic<uint64_t>> buckets_;
+	std::atomic<uint64_t> count_;
+	std::atomic<uint64_t> sum_;
+	std::atomic<uint64_t> min_;
+	std::atomic<uint64_t> max_;
+};
+
+} // namespace narf
+
+#endif // NARF_HISTOGRAM_H
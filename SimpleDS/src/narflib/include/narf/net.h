@@ -17,7 +17,9 @@
 #include <sys/socket.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <net/if.h>
 typedef int SOCKET;
+#define INVALID_SOCKET (-1)
 #endif
 
 #include <vector>
@@ -32,6 +34,7 @@ namespace narf {
 
 		class Address {
 		public:
+			Address(); // AF_UNSPEC, matches nothing
 			Address(const struct sockaddr_in& ipv4);
 			Address(const struct sockaddr_in6& ipv6);
 			Address(const struct sockaddr_storage& saStorage);
@@ -39,8 +42,23 @@ namespace narf {
 
 			const struct sockaddr* sockaddr() const;
 			socklen_t sockaddrLen() const;
+			int family() const { return saStorage.ss_family; }
 
-			bool operator==(const Address& other);
+			uint16_t port() const;
+			void setPort(uint16_t port);
+
+			// IPv4 addresses as a dual-stack IPv6 socket sees them (::ffff:a.b.c.d)
+			bool isV4Mapped() const;
+			Address toV4Mapped() const; // IPv4 -> ::ffff:a.b.c.d, anything else unchanged
+			Address unmapped() const; // ::ffff:a.b.c.d -> IPv4, anything else unchanged
+
+			// same host, ignoring the port and whether IPv4 is mapped
+			bool sameHost(const Address& other) const;
+
+			// numeric host without the port; link-local IPv6 gets its %interface
+			std::string toString() const;
+
+			bool operator==(const Address& other) const;
 
 		private:
 			union {
@@ -54,6 +72,10 @@ namespace narf {
 		public:
 			AddrInfo(const struct addrinfo& ai);
 
+			int getSocktype() const { return socktype; }
+			int getProtocol() const { return protocol; }
+			const Address& getAddress() const { return addr; }
+
 		private:
 			int socktype;
 			int protocol;
@@ -68,12 +90,34 @@ namespace narf {
 			Socket(int family, int type, int protocol);
 			~Socket();
 
+			bool valid() const { return sock != INVALID_SOCKET; }
+			int family() const { return fam; }
+
 			void close();
 			bool setNonBlocking(bool nonBlocking);
+			bool setReuseAddr(bool reuse);
+			// IPv6 sockets only: false lets one socket talk to IPv4 peers too
+			bool setV6Only(bool v6Only);
+			bool bind(const Address& addr);
+			bool localAddress(Address& addr) const;
+			// UDP: only exchange datagrams with addr from now on. The kernel
+			// drops anyone else's, and an ICMP error for something sent fails
+			// a later send() (ECONNREFUSED for port unreachable).
+			bool connect(const Address& addr);
+			// Back to unconnected. A socket bound to port 0 loses its port.
+			bool disconnect();
+			bool send(const void* data, size_t size);
+			// IPv4 addresses are mapped first when the socket is IPv6
 			bool sendto(const void* data, size_t size, const Address& addr);
 			bool recvfrom(void* data, size_t availableSize, size_t& received, Address& addr);
 
 			SOCKET sock;
+
+		private:
+			int fam;
+
+			Socket(const Socket&) = delete;
+			Socket& operator=(const Socket&) = delete;
 		};
 	}
 }
@@ -0,0 +1,106 @@
+/*
+ * Memory-mapped ring buffer file
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_RINGFILE_H
+#define NARF_RINGFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include <functional>
+
+namespace narf {
+
+// Fixed-size ring of variable-length records in a memory-mapped file. The
+// newest records overwrite the oldest once it fills. append() is lock-free,
+// never allocates and never makes a syscall, so it can run from a timing
+// sensitive loop; the kernel writes the pages back on its own, and they
+// survive the process crashing. Only one thread (or process) may append.
+class RingFile {
+public:
+	struct Record {
+		uint64_t stamp;
+		uint8_t type;
+		const uint8_t* data;
+		uint32_t size;
+	};
+
+	RingFile();
+	~RingFile();
+
+	// Open for appending. An existing ring with the same capacity is kept and
+	// appended to; anything else at filename is replaced.
+	bool open(const std::string& filename, size_t capacity);
+	// Open an existing ring to read it
+	bool openReadOnly(const std::string& filename);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+
+	// Records larger than a quarter of the capacity are refused
+	bool append(uint8_t type, uint64_t stamp, const void* data, uint32_t size);
+
+	// Visit records from oldest to newest
+	void forEach(const std::function<void(const Record&)>& fn) const;
+
+	size_t capacity() const;
+	uint64_t bytesWritten() const; // Total ever appended, including overwritten
+
+private:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint64_t capacity;
+		std::atomic<uint64_t> head; // Stream offset the next record goes at
+		std::atomic<uint64_t> tail; // Stream offset of the oldest record
+	};
+
+	struct RecordHeader {
+		uint32_t size;
+		uint8_t type;
+		uint8_t pad[3];
+		uint64_t stamp;
+	};
+
+	Header* header;
+	uint8_t* ring;
+	size_t mapSize;
+	bool writable;
+
+	bool map(int fd, size_t size, bool write);
+	uint64_t next(uint64_t pos) const;
+};
+
+} // namespace narf
+
+#endif // NARF_RINGFILE_H
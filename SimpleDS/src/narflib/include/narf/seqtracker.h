@@ -0,0 +1,87 @@
+/*
+ * Sequence number loss and reorder tracking
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_SEQTRACKER_H
+#define NARF_SEQTRACKER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "narf/histogram.h"
+
+namespace narf {
+
+// Loss accounting for a 16-bit wrapping sequence number. Keeps a 64 entry
+// window behind the newest sequence seen so late packets can be told apart
+// from duplicates; a late packet un-counts the loss its gap recorded.
+// One thread may add() while others read the counters.
+class SeqTracker {
+public:
+	enum class Result { FIRST, NEXT, GAP, LATE, DUPLICATE, STALE };
+
+	SeqTracker(size_t maxBurst = 32);
+
+	Result add(uint16_t seq);
+	void reset();
+
+	uint64_t received() const { return received_.load(std::memory_order_relaxed); }
+	uint64_t lost() const { return lost_.load(std::memory_order_relaxed); }
+	uint64_t late() const { return late_.load(std::memory_order_relaxed); }
+	uint64_t duplicates() const { return duplicates_.load(std::memory_order_relaxed); }
+	uint64_t stale() const { return stale_.load(std::memory_order_relaxed); } // Too old to tell
+	uint64_t wraps() const { return wraps_.load(std::memory_order_relaxed); }
+	uint16_t newest() const { return top; }
+
+	// Length of each run of missing sequence numbers, as seen when the gap was
+	// found (a late packet filling it in afterwards isn't taken back out)
+	const Histogram& bursts() const { return bursts_; }
+
+private:
+	bool started;
+	uint16_t top;
+	uint64_t window; // Bit n set if top - n has been seen
+	std::atomic<uint64_t> received_;
+	std::atomic<uint64_t> lost_;
+	std::atomic<uint64_t> late_;
+	std::atomic<uint64_t> duplicates_;
+	std::atomic<uint64_t> stale_;
+	std::atomic<uint64_t> wraps_;
+	Histogram bursts_;
+
+	static void inc(std::atomic<uint64_t>& v, int64_t by = 1) {
+		v.store(v.load(std::memory_order_relaxed) + (uint64_t)by, std::memory_order_relaxed);
+	}
+};
+
+} // namespace narf
+
+#endif // NARF_SEQTRACKER_H
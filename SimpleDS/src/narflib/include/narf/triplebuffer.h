@@ -0,0 +1,85 @@
+/*
+ * Lock-free single producer, single consumer triple buffer
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NARF_TRIPLEBUFFER_H
+#define NARF_TRIPLEBUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+namespace narf {
+
+// Hands the newest copy of a value from one writer thread to one reader
+// thread without either ever waiting. The writer fills in back() and
+// publish()es it; the reader calls update() to pick up whatever was
+// published last and reads front() until the next update(). Values the
+// reader never got to are skipped. back() holds an older copy after
+// publish(), so the writer should fill in the whole thing each time.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() : middle(1), backIdx(0), frontIdx(2) {
+		for (auto& b : bufs) {
+			b = T();
+		}
+	}
+
+	T& back() { return bufs[backIdx]; }
+
+	void publish() {
+		backIdx = (uint8_t)(middle.exchange((uint8_t)(backIdx | FRESH), std::memory_order_acq_rel) & INDEX);
+	}
+
+	// Returns true if there was something new
+	bool update() {
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+			return false;
+		}
+		frontIdx = (uint8_t)(middle.exchange(frontIdx, std::memory_order_acq_rel) & INDEX);
+		return true;
+	}
+
+	const T& front() const { return bufs[frontIdx]; }
+
+private:
+	static const uint8_t INDEX = 0x03;
+	static const uint8_t FRESH = 0x04;
+
+	T bufs[3];
+	std::atomic<uint8_t> middle; // Index of the buffer between the two, and FRESH if the reader hasn't seen it
+	uint8_t backIdx; // Writer only
+	uint8_t frontIdx; // Reader only
+};
+
+} // namespace narf
+
+#endif // NARF_TRIPLEBUFFER_H
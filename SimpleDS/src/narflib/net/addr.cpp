@@ -57,6 +57,15 @@ bool net::splitHostPort(const std::string &addr, std::string &host, uint16_t &po
 }
 
 
+static const uint8_t v4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+
+net::Address::Address() {
+	memset(&saStorage, 0, sizeof(saStorage));
+	saStorage.ss_family = AF_UNSPEC;
+}
+
+
 net::Address::Address(const struct sockaddr_in& ipv4) : ipv4(ipv4) {
 }
 
@@ -88,7 +97,103 @@ socklen_t net::Address::sockaddrLen() const {
 }
 
 
-bool net::Address::operator==(const Address& other) {
+uint16_t net::Address::port() const {
+	switch (saStorage.ss_family) {
+	case AF_INET:   return ntohs(ipv4.sin_port);
+	case AF_INET6:  return ntohs(ipv6.sin6_port);
+	}
+	return 0;
+}
+
+
+void net::Address::setPort(uint16_t port) {
+	switch (saStorage.ss_family) {
+	case AF_INET:   ipv4.sin_port = htons(port); break;
+	case AF_INET6:  ipv6.sin6_port = htons(port); break;
+	}
+}
+
+
+bool net::Address::isV4Mapped() const {
+	return saStorage.ss_family == AF_INET6 &&
+		memcmp(&ipv6.sin6_addr, v4MappedPrefix, sizeof(v4MappedPrefix)) == 0;
+}
+
+
+net::Address net::Address::toV4Mapped() const {
+	if (saStorage.ss_family != AF_INET) {
+		return *this;
+	}
+	struct sockaddr_in6 sin6;
+	memset(&sin6, 0, sizeof(sin6));
+	sin6.sin6_family = AF_INET6;
+	sin6.sin6_port = ipv4.sin_port;
+	auto bytes = reinterpret_cast<uint8_t*>(&sin6.sin6_addr);
+	memcpy(bytes, v4MappedPrefix, sizeof(v4MappedPrefix));
+	memcpy(bytes + sizeof(v4MappedPrefix), &ipv4.sin_addr, 4);
+	return Address(sin6);
+}
+
+
+net::Address net::Address::unmapped() const {
+	if (!isV4Mapped()) {
+		return *this;
+	}
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = ipv6.sin6_port;
+	memcpy(&sin.sin_addr, reinterpret_cast<const uint8_t*>(&ipv6.sin6_addr) + sizeof(v4MappedPrefix), 4);
+	return Address(sin);
+}
+
+
+bool net::Address::sameHost(const Address& other) const {
+	auto a = unmapped();
+	auto b = other.unmapped();
+	if (a.family() != b.family()) {
+		return false;
+	}
+	switch (a.family()) {
+	case AF_INET:
+		return a.ipv4.sin_addr.s_addr == b.ipv4.sin_addr.s_addr;
+	case AF_INET6:
+		return
+			memcmp(&a.ipv6.sin6_addr, &b.ipv6.sin6_addr, sizeof(a.ipv6.sin6_addr)) == 0 &&
+			a.ipv6.sin6_scope_id == b.ipv6.sin6_scope_id;
+	}
+	return false;
+}
+
+
+std::string net::Address::toString() const {
+	char host[INET6_ADDRSTRLEN];
+	switch (saStorage.ss_family) {
+	case AF_INET:
+		if (!inet_ntop(AF_INET, const_cast<struct in_addr*>(&ipv4.sin_addr), host, sizeof(host))) {
+			return "";
+		}
+		return host;
+	case AF_INET6:
+		if (!inet_ntop(AF_INET6, const_cast<struct in6_addr*>(&ipv6.sin6_addr), host, sizeof(host))) {
+			return "";
+		}
+		if (ipv6.sin6_scope_id != 0) {
+#ifndef _WIN32
+			char ifname[IF_NAMESIZE];
+			if (if_indextoname(ipv6.sin6_scope_id, ifname)) {
+				return std::string(host) + "%" + ifname;
+			}
+#endif
+			return std::string(host) + "%" + std::to_string(ipv6.sin6_scope_id);
+		}
+		return host;
+	}
+	return "";
+}
+
+
+bool net::Address::operator==(const Address& other) const {
 	if (saStorage.ss_family != other.saStorage.ss_family) {
 		return false;
 	}
@@ -103,6 +208,8 @@ bool net::Address::operator==(const Address& other) {
 			ipv6.sin6_port == other.ipv6.sin6_port &&
 			memcmp(&ipv6.sin6_addr, &other.ipv6.sin6_addr, sizeof(ipv6.sin6_addr)) == 0 &&
 			ipv6.sin6_scope_id == other.ipv6.sin6_scope_id;
+	case AF_UNSPEC:
+		return true;
 	}
 
 	assert(0);
@@ -8,25 +8,26 @@
 
 using namespace narf;
 
-net::Socket::Socket(int family, int type, int protocol) {
+net::Socket::Socket(int family, int type, int protocol) : fam(family) {
 	sock = socket(family, type, protocol);
-	// TODO: check return value
 }
 
 
 net::Socket::~Socket() {
-	if (sock) { // TODO: what is invalid socket value? -1?
-		close();
-	}
+	close();
 }
 
 
 void net::Socket::close() {
+	if (!valid()) {
+		return;
+	}
 #ifdef _WIN32
 	closesocket(sock);
 #else
 	::close(sock);
 #endif
+	sock = INVALID_SOCKET;
 }
 
 
@@ -46,7 +47,67 @@ bool net::Socket::setNonBlocking(bool nonblocking) {
 }
 
 
+bool net::Socket::setReuseAddr(bool reuse) {
+	int val = reuse ? 1 : 0;
+	return setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&val), sizeof(val)) == 0;
+}
+
+
+bool net::Socket::setV6Only(bool v6Only) {
+	if (fam != AF_INET6) {
+		return false;
+	}
+	int val = v6Only ? 1 : 0;
+	return setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&val), sizeof(val)) == 0;
+}
+
+
+bool net::Socket::bind(const Address& addr) {
+	auto a = fam == AF_INET6 ? addr.toV4Mapped() : addr;
+	return ::bind(sock, a.sockaddr(), a.sockaddrLen()) == 0;
+}
+
+
+bool net::Socket::localAddress(Address& addr) const {
+	struct sockaddr_storage ss;
+	socklen_t len = sizeof(ss);
+	if (getsockname(sock, reinterpret_cast<struct sockaddr*>(&ss), &len) != 0) {
+		return false;
+	}
+	addr = Address(ss);
+	return true;
+}
+
+
+bool net::Socket::connect(const Address& addr) {
+	auto a = fam == AF_INET6 ? addr.toV4Mapped() : addr;
+	return ::connect(sock, a.sockaddr(), a.sockaddrLen()) == 0;
+}
+
+
+bool net::Socket::disconnect() {
+	struct sockaddr sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_family = AF_UNSPEC;
+	return ::connect(sock, &sa, sizeof(sa)) == 0;
+}
+
+
+bool net::Socket::send(const void* data, size_t size) {
+#ifdef _WIN32
+	auto d = static_cast<const char*>(data);
+	auto sz = static_cast<int>(size);
+#else
+	const void* d = data;
+	size_t sz = size;
+#endif
+	ssize_t sent = ::send(sock, d, sz, 0);
+	return sent == static_cast<ssize_t>(size);
+}
+
+
 bool net::Socket::sendto(const void* data, size_t size, const Address& addr) {
+	auto a = fam == AF_INET6 ? addr.toV4Mapped() : addr;
 #ifdef _WIN32
 	auto d = static_cast<const char*>(data);
 	auto sz = static_cast<int>(size);
@@ -54,7 +115,7 @@ bool net::Socket::sendto(const void* data, size_t size, const Address& addr) {
 	const void* d = data;
 	size_t sz = size;
 #endif
-	ssize_t sent = ::sendto(sock, d, sz, 0, addr.sockaddr(), addr.sockaddrLen());
+	ssize_t sent = ::sendto(sock, d, sz, 0, a.sockaddr(), a.sockaddrLen());
 	return sent == static_cast<ssize_t>(size);
 }
 
@@ -0,0 +1,55 @@
+/*
+ * 16-bit to 8-bit sample quantization
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "narf/quantize.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void narf::quantize16to8(const int16_t* in, int8_t* out, size_t count) {
+	size_t i = 0;
+#ifdef __SSE2__
+	// An arithmetic shift rounds down, division rounds toward zero, so
+	// negative values get 255 added first to make them come out the same
+	const __m128i bias = _mm_set1_epi16(255);
+	for (; i + 8 <= count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i neg = _mm_srai_epi16(v, 15);
+		v = _mm_srai_epi16(_mm_add_epi16(v, _mm_and_si128(neg, bias)), 8);
+		_mm_storel_epi64((__m128i*)(out + i), _mm_packs_epi16(v, v));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = (int8_t)(in[i] / 256);
+	}
+}
@@ -0,0 +1,222 @@
+/*
+ * Memory-mapped ring buffer file
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "narf/ringfile.h"
+
+#define RING_MAGIC "NARFRING"
+#define RING_VERSION 1
+#define RING_HEADER_SIZE 64
+#define RING_PAD 0xffffffffu // Rest of the ring up to the wrap point is unused
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomics must be plain words to live in a file");
+
+static inline uint64_t align8(uint64_t v) {
+	return (v + 7) & ~(uint64_t)7;
+}
+
+narf::RingFile::RingFile() : header(nullptr), ring(nullptr), mapSize(0), writable(false) { }
+
+narf::RingFile::~RingFile() {
+	close();
+}
+
+bool narf::RingFile::map(int fd, size_t size, bool write) {
+	int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	if (write) {
+		flags |= MAP_POPULATE; // Fault the pages in now rather than in append()
+	}
+#endif
+	void* p = mmap(nullptr, size, write ? (PROT_READ | PROT_WRITE) : PROT_READ, flags, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+	header = static_cast<Header*>(p);
+	ring = static_cast<uint8_t*>(p) + RING_HEADER_SIZE;
+	mapSize = size;
+	writable = write;
+	return true;
+}
+
+bool narf::RingFile::open(const std::string& filename, size_t capacity) {
+	close();
+	capacity &= ~(size_t)7;
+	if (capacity < 64) {
+		return false;
+	}
+	int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		return false;
+	}
+	size_t size = RING_HEADER_SIZE + capacity;
+
+	Header existing;
+	bool keep = (pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+			memcmp(existing.magic, RING_MAGIC, 8) == 0 && existing.version == RING_VERSION &&
+			existing.headerSize == RING_HEADER_SIZE && existing.capacity == capacity);
+	if (!keep && (ftruncate(fd, 0) == -1 || ftruncate(fd, (off_t)size) == -1)) {
+		::close(fd);
+		return false;
+	}
+	if (!map(fd, size, true)) {
+		return false;
+	}
+	if (!keep) {
+		memcpy(header->magic, RING_MAGIC, 8);
+		header->version = RING_VERSION;
+		header->headerSize = RING_HEADER_SIZE;
+		header->capacity = capacity;
+		header->head.store(0, std::memory_order_relaxed);
+		header->tail.store(0, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+bool narf::RingFile::openReadOnly(const std::string& filename) {
+	close();
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	struct stat st;
+	Header h;
+	if (fstat(fd, &st) == -1 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+			memcmp(h.magic, RING_MAGIC, 8) != 0 || h.version != RING_VERSION ||
+			h.headerSize != RING_HEADER_SIZE || (uint64_t)st.st_size < RING_HEADER_SIZE + h.capacity) {
+		::close(fd);
+		return false;
+	}
+	return map(fd, (size_t)(RING_HEADER_SIZE + h.capacity), false);
+}
+
+void narf::RingFile::close() {
+	if (header) {
+		munmap(header, mapSize);
+	}
+	header = nullptr;
+	ring = nullptr;
+	mapSize = 0;
+	writable = false;
+}
+
+size_t narf::RingFile::capacity() const {
+	return header ? (size_t)header->capacity : 0;
+}
+
+uint64_t narf::RingFile::bytesWritten() const {
+	return header ? header->head.load(std::memory_order_acquire) : 0;
+}
+
+uint64_t narf::RingFile::next(uint64_t pos) const {
+	uint64_t cap = header->capacity;
+	uint64_t phys = pos % cap;
+	uint32_t size;
+	memcpy(&size, ring + phys, sizeof(size));
+	if (size == RING_PAD) {
+		return pos + (cap - phys);
+	}
+	return pos + align8(sizeof(RecordHeader) + size);
+}
+
+bool narf::RingFile::append(uint8_t type, uint64_t stamp, const void* data, uint32_t size) {
+	if (!writable) {
+		return false;
+	}
+	uint64_t cap = header->capacity;
+	uint64_t n = align8(sizeof(RecordHeader) + (uint64_t)size);
+	if (n > cap / 4) {
+		return false;
+	}
+
+	uint64_t head = header->head.load(std::memory_order_relaxed);
+	uint64_t phys = head % cap;
+	uint64_t skip = (phys + n > cap) ? (cap - phys) : 0; // Records never straddle the end
+	uint64_t end = head + skip + n;
+
+	// Retire whatever the new record is about to overwrite before touching it
+	uint64_t tail = header->tail.load(std::memory_order_relaxed);
+	while (end - tail > cap) {
+		tail = next(tail);
+	}
+	header->tail.store(tail, std::memory_order_release);
+
+	if (skip) {
+		uint32_t pad = RING_PAD;
+		memcpy(ring + phys, &pad, sizeof(pad));
+		phys = 0;
+	}
+	RecordHeader rh;
+	rh.size = size;
+	rh.type = type;
+	memset(rh.pad, 0, sizeof(rh.pad));
+	rh.stamp = stamp;
+	memcpy(ring + phys, &rh, sizeof(rh));
+	if (size) {
+		memcpy(ring + phys + sizeof(rh), data, size);
+	}
+	header->head.store(end, std::memory_order_release);
+	return true;
+}
+
+void narf::RingFile::forEach(const std::function<void(const Record&)>& fn) const {
+	if (!header) {
+		return;
+	}
+	uint64_t cap = header->capacity;
+	uint64_t head = header->head.load(std::memory_order_acquire);
+	uint64_t pos = header->tail.load(std::memory_order_acquire);
+	while (pos < head) {
+		uint64_t phys = pos % cap;
+		RecordHeader rh;
+		memcpy(&rh, ring + phys, sizeof(rh.size));
+		if (rh.size != RING_PAD) {
+			memcpy(&rh, ring + phys, sizeof(rh));
+			if (phys + sizeof(rh) + rh.size > cap) {
+				break; // Corrupt, don't read past the map
+			}
+			Record r;
+			r.stamp = rh.stamp;
+			r.type = rh.type;
+			r.data = ring + phys + sizeof(rh);
+			r.size = rh.size;
+			fn(r);
+		}
+		pos = next(pos);
+	}
+}
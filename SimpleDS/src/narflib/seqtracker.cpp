@@ -0,0 +1,93 @@
+/*
+ * Sequence number loss and reorder tracking
+ *
+ * Copyright (c) 2015 Daniel Verkamp, Jessica Creighton
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in
+ * the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+ * WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "narf/seqtracker.h"
+
+narf::SeqTracker::SeqTracker(size_t maxBurst /*= 32*/) : bursts_(1, maxBurst) {
+	reset();
+}
+
+void narf::SeqTracker::reset() {
+	started = false;
+	top = 0;
+	window = 0;
+	received_.store(0, std::memory_order_relaxed);
+	lost_.store(0, std::memory_order_relaxed);
+	late_.store(0, std::memory_order_relaxed);
+	duplicates_.store(0, std::memory_order_relaxed);
+	stale_.store(0, std::memory_order_relaxed);
+	wraps_.store(0, std::memory_order_relaxed);
+	bursts_.reset();
+}
+
+narf::SeqTracker::Result narf::SeqTracker::add(uint16_t seq) {
+	if (!started) {
+		started = true;
+		top = seq;
+		window = 1;
+		inc(received_);
+		return Result::FIRST;
+	}
+
+	// Signed distance handles the wrap from 0xffff back to 0
+	int16_t d = (int16_t)(uint16_t)(seq - top);
+	if (d > 0) {
+		window = (d < 64) ? ((window << d) | 1) : 1;
+		if (seq < top) {
+			inc(wraps_);
+		}
+		top = seq;
+		inc(received_);
+		if (d == 1) {
+			return Result::NEXT;
+		}
+		inc(lost_, d - 1);
+		bursts_.add((uint64_t)(d - 1));
+		return Result::GAP;
+	}
+
+	uint64_t age = (uint64_t)(-(int32_t)d);
+	if (age >= 64) {
+		inc(stale_);
+		return Result::STALE;
+	}
+	uint64_t bit = (uint64_t)1 << age;
+	if (window & bit) {
+		inc(duplicates_);
+		return Result::DUPLICATE;
+	}
+	window |= bit;
+	inc(received_);
+	inc(late_);
+	inc(lost_, -1);
+	return Result::LATE;
+}
@@ -0,0 +1,61 @@
+#include "narf/bytereader.h"
+#include "narf/bytestream.h"
+#include "alloccount.h"
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+TEST(ByteReader, Ints) {
+	const uint8_t data[] = {0x39, 0x9c, 0xa0, 0xb1, 0xa0, 0xb1, 0xa0, 0xb1, 0xc2, 0xd3};
+	narf::ByteReader r(data, sizeof(data));
+	ASSERT_EQ(57, r.readU8());
+	ASSERT_EQ(-100, r.readI8());
+	ASSERT_EQ(0xb1a0, r.readU16());
+	ASSERT_EQ(0xa0b1, r.readU16(BE));
+	ASSERT_EQ(0xa0b1c2d3, r.readU32(BE));
+	ASSERT_EQ(0u, r.bytesLeft());
+	ASSERT_FALSE(r.overran());
+}
+
+TEST(ByteReader, Float) {
+	narf::ByteStream bs;
+	bs.write(1.5f, BE);
+	narf::ByteReader r(bs.data(), bs.size());
+	ASSERT_EQ(1.5f, r.readFloat(BE));
+}
+
+TEST(ByteReader, Overrun) {
+	const uint8_t data[] = {0x01, 0x02, 0x03};
+	narf::ByteReader r(data, sizeof(data));
+	ASSERT_EQ(0x0102, r.readU16(BE));
+	ASSERT_EQ(0u, r.readU16(BE));
+	ASSERT_TRUE(r.overran());
+	ASSERT_EQ(0u, r.bytesLeft());
+}
+
+TEST(ByteReader, Sub) {
+	const uint8_t data[] = {0x02, 0xaa, 0xbb, 0x05, 0xcc};
+	narf::ByteReader r(data, sizeof(data));
+	auto s = r.sub(r.readU8());
+	ASSERT_EQ(2u, s.size());
+	ASSERT_EQ(0xaa, s.readU8());
+	ASSERT_EQ(3u, r.tell());
+	auto t = r.sub(r.readU8());
+	ASSERT_EQ(1u, t.size());
+	ASSERT_TRUE(r.overran());
+	ASSERT_EQ(0xcc, t.readU8());
+}
+
+TEST(ByteReader, NoAllocations) {
+	const uint8_t data[] = {0x03, 0x01, 0xaa, 0xbb, 0x02, 0x04, 0xcc, 0x01, 0x05};
+	auto allocs = allocCount();
+	uint32_t sum = 0;
+	for (int i = 0; i < 1000; i++) {
+		narf::ByteReader r(data, sizeof(data));
+		while (r.bytesLeft() > 1) {
+			auto tag = r.sub(r.readU8());
+			sum += tag.readU8();
+		}
+	}
+	ASSERT_EQ(0u, allocCount() - allocs);
+	ASSERT_EQ(1000u * (1 + 4 + 5), sum);
+}
@@ -0,0 +1,56 @@
+#include "narf/bytewriter.h"
+#include "alloccount.h"
+#include <stdint.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+TEST(ByteWriter, Ints) {
+	uint8_t buf[16];
+	narf::ByteWriter w(buf, sizeof(buf));
+	w.write((uint8_t)57);
+	w.write((int8_t)-100);
+	w.write((uint16_t)0xa0b1);
+	w.write((uint16_t)0xa0b1, BE);
+	w.write((uint32_t)0xa0b1c2d3, BE);
+	ASSERT_EQ(10u, w.size());
+	const uint8_t expected[] = {0x39, 0x9c, 0xb1, 0xa0, 0xa0, 0xb1, 0xa0, 0xb1, 0xc2, 0xd3};
+	ASSERT_EQ(0, memcmp(expected, buf, sizeof(expected)));
+	ASSERT_FALSE(w.overran());
+}
+
+TEST(ByteWriter, Overrun) {
+	uint8_t buf[3];
+	narf::ByteWriter w(buf, sizeof(buf));
+	ASSERT_TRUE(w.write((uint16_t)0x0102, BE));
+	ASSERT_FALSE(w.write((uint16_t)0x0304, BE));
+	ASSERT_TRUE(w.overran());
+	ASSERT_EQ(2u, w.size());
+	ASSERT_TRUE(w.write((uint8_t)0x05));
+	ASSERT_EQ(0u, w.bytesLeft());
+}
+
+TEST(ByteWriter, Patch) {
+	uint8_t buf[4];
+	narf::ByteWriter w(buf, sizeof(buf));
+	w.write((uint8_t)0);
+	w.write((uint16_t)0xffff);
+	ASSERT_TRUE(w.patch(0, (uint8_t)(w.size() - 1)));
+	ASSERT_FALSE(w.patch(3, 0));
+	ASSERT_EQ(2, buf[0]);
+}
+
+TEST(ByteWriter, NoAllocations) {
+	uint8_t buf[64];
+	narf::ByteWriter w(buf, sizeof(buf));
+	auto allocs = allocCount();
+	for (int i = 0; i < 1000; i++) {
+		w.clear();
+		size_t start = w.tell();
+		w.write((uint8_t)0);
+		w.write((uint16_t)i, BE);
+		w.write((uint32_t)i, BE);
+		w.patch(start, (uint8_t)(w.tell() - start - 1));
+	}
+	ASSERT_EQ(0u, allocCount() - allocs);
+	ASSERT_EQ(6, buf[0]);
+}
@@ -0,0 +1,58 @@
+#include "narf/histogram.h"
+#include <gtest/gtest.h>
+
+TEST(Histogram, Empty) {
+	narf::Histogram h(10, 10);
+	ASSERT_EQ(0u, h.count());
+	ASSERT_EQ(0u, h.min());
+	ASSERT_EQ(0u, h.max());
+	ASSERT_EQ(0.0, h.mean());
+	ASSERT_EQ(0u, h.percentile(99));
+	ASSERT_EQ(11u, h.bucketCount());
+}
+
+TEST(Histogram, Stats) {
+	narf::Histogram h(10, 10);
+	for (uint64_t i = 1; i <= 100; i++) {
+		h.add(i);
+	}
+	ASSERT_EQ(100u, h.count());
+	ASSERT_EQ(1u, h.min());
+	ASSERT_EQ(100u, h.max());
+	ASSERT_DOUBLE_EQ(50.5, h.mean());
+	ASSERT_EQ(9u, h.bucket(0));
+	ASSERT_EQ(10u, h.bucket(1));
+	ASSERT_EQ(1u, h.bucket(10));
+	ASSERT_EQ(59u, h.percentile(50));
+	ASSERT_EQ(99u, h.percentile(99));
+	ASSERT_EQ(100u, h.percentile(100));
+}
+
+TEST(Histogram, Overflow) {
+	narf::Histogram h(1, 4);
+	h.add(2);
+	h.add(1000);
+	ASSERT_EQ(1u, h.bucket(4));
+	ASSERT_EQ(2u, h.percentile(50));
+	ASSERT_EQ(1000u, h.percentile(99));
+	h.reset();
+	ASSERT_EQ(0u, h.count());
+	ASSERT_EQ(0u, h.bucket(4));
+}
+
+TEST(Histogram, Merge) {
+	narf::Histogram a(10, 10), b(10, 10), c(5, 10);
+	a.add(5);
+	a.add(50);
+	b.add(1);
+	b.add(500);
+	ASSERT_TRUE(a.merge(b));
+	ASSERT_EQ(4u, a.count());
+	ASSERT_EQ(1u, a.min());
+	ASSERT_EQ(500u, a.max());
+	ASSERT_DOUBLE_EQ(139.0, a.mean());
+	ASSERT_EQ(2u, a.bucket(0));
+	ASSERT_EQ(1u, a.bucket(10));
+	ASSERT_FALSE(a.merge(c));
+	ASSERT_EQ(4u, a.count());
+}
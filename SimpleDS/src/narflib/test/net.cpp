@@ -1,4 +1,7 @@
 #include "narf/net.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <gtest/gtest.h>
 
 using namespace narf;
@@ -58,3 +61,151 @@ TEST(splitHostPortTest, Invalid) {
 	EXPECT_EQ(false, narf::net::splitHostPort("host::80", host, port));
 	EXPECT_EQ(false, narf::net::splitHostPort("example.com::80", host, port));
 }
+
+
+namespace {
+
+net::Address makeAddress(const char* host, uint16_t port) {
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_flags = AI_NUMERICHOST;
+	hints.ai_socktype = SOCK_DGRAM;
+	std::vector<net::AddrInfo> results;
+	EXPECT_TRUE(net::getaddrinfo(host, nullptr, &hints, results)) << host;
+	EXPECT_FALSE(results.empty());
+	auto addr = results.empty() ? net::Address() : results[0].getAddress();
+	addr.setPort(port);
+	return addr;
+}
+
+} // namespace
+
+
+TEST(AddressTest, Format) {
+	EXPECT_EQ("10.12.34.2", makeAddress("10.12.34.2", 0).toString());
+	EXPECT_EQ("fd00::2", makeAddress("fd00::2", 0).toString());
+	EXPECT_EQ("::ffff:10.12.34.2", makeAddress("::ffff:10.12.34.2", 0).toString());
+	EXPECT_EQ("", net::Address().toString());
+}
+
+
+TEST(AddressTest, Port) {
+	auto addr = makeAddress("10.12.34.2", 1110);
+	EXPECT_EQ(1110, addr.port());
+	addr.setPort(1150);
+	EXPECT_EQ(1150, addr.port());
+	EXPECT_EQ(1150, addr.toV4Mapped().port());
+	EXPECT_EQ(0, net::Address().port());
+}
+
+
+TEST(AddressTest, V4Mapped) {
+	auto v4 = makeAddress("10.12.34.2", 1110);
+	auto mapped = makeAddress("::ffff:10.12.34.2", 1110);
+	auto v6 = makeAddress("fd00::2", 1110);
+
+	EXPECT_FALSE(v4.isV4Mapped());
+	EXPECT_TRUE(mapped.isV4Mapped());
+	EXPECT_FALSE(v6.isV4Mapped());
+
+	EXPECT_TRUE(v4.toV4Mapped() == mapped);
+	EXPECT_TRUE(mapped.unmapped() == v4);
+	EXPECT_TRUE(v4.unmapped() == v4);
+	EXPECT_TRUE(v6.toV4Mapped() == v6);
+	EXPECT_TRUE(v6.unmapped() == v6);
+	EXPECT_FALSE(v4 == mapped);
+}
+
+
+TEST(AddressTest, SameHost) {
+	auto v4 = makeAddress("10.12.34.2", 1110);
+	EXPECT_TRUE(v4.sameHost(makeAddress("10.12.34.2", 1150)));
+	EXPECT_TRUE(v4.sameHost(makeAddress("::ffff:10.12.34.2", 1150)));
+	EXPECT_FALSE(v4.sameHost(makeAddress("10.12.34.3", 1110)));
+	EXPECT_FALSE(v4.sameHost(makeAddress("fd00::2", 1110)));
+	EXPECT_TRUE(makeAddress("fd00::2", 1).sameHost(makeAddress("fd00::2", 2)));
+	EXPECT_FALSE(v4.sameHost(net::Address()));
+}
+
+
+TEST(SocketTest, DualStack) {
+	// An IPv4 packet arrives on an IPv6 socket from a mapped address
+	net::Socket in(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	if (!in.valid()) {
+		printf("No IPv6 here, skipping\n");
+		return;
+	}
+	ASSERT_TRUE(in.setV6Only(false));
+	ASSERT_TRUE(in.bind(makeAddress("::", 0)));
+	net::Address local;
+	ASSERT_TRUE(in.localAddress(local));
+
+	net::Socket out(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	ASSERT_TRUE(out.valid());
+	ASSERT_TRUE(out.sendto("hi", 2, makeAddress("127.0.0.1", local.port())));
+
+	char buf[16];
+	size_t received = 0;
+	net::Address from;
+	ASSERT_TRUE(in.recvfrom(buf, sizeof(buf), received, from));
+	EXPECT_EQ(2u, received);
+	EXPECT_TRUE(from.isV4Mapped());
+	EXPECT_EQ("127.0.0.1", from.unmapped().toString());
+
+	// And an IPv6 socket sends to a plain IPv4 address by mapping it
+	net::Socket in4(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	ASSERT_TRUE(in4.bind(makeAddress("127.0.0.1", 0)));
+	ASSERT_TRUE(in4.localAddress(local));
+	ASSERT_TRUE(in.sendto("hey", 3, local));
+	ASSERT_TRUE(in4.recvfrom(buf, sizeof(buf), received, from));
+	EXPECT_EQ(3u, received);
+}
+
+
+TEST(SocketTest, Connected) {
+	net::Socket in(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	ASSERT_TRUE(in.bind(makeAddress("127.0.0.1", 0)));
+	net::Address inAddr;
+	ASSERT_TRUE(in.localAddress(inAddr));
+
+	net::Socket peer(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	net::Socket stranger(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	ASSERT_TRUE(stranger.bind(makeAddress("127.0.0.1", 0)));
+	ASSERT_TRUE(peer.bind(makeAddress("127.0.0.1", 0)));
+	net::Address peerAddr;
+	ASSERT_TRUE(peer.localAddress(peerAddr));
+
+	ASSERT_TRUE(in.connect(peerAddr));
+	ASSERT_TRUE(in.setNonBlocking(true));
+	ASSERT_TRUE(stranger.sendto("no", 2, inAddr));
+	ASSERT_TRUE(peer.sendto("yes", 3, inAddr));
+
+	char buf[16];
+	size_t received = 0;
+	net::Address from;
+	ASSERT_TRUE(in.recvfrom(buf, sizeof(buf), received, from));
+	EXPECT_EQ(3u, received);
+	EXPECT_TRUE(from == peerAddr);
+	EXPECT_FALSE(in.recvfrom(buf, sizeof(buf), received, from));
+
+	ASSERT_TRUE(in.send("back", 4));
+	ASSERT_TRUE(peer.recvfrom(buf, sizeof(buf), received, from));
+	EXPECT_EQ(4u, received);
+
+	// Nothing listens on peer's port once it's closed
+	peer.close();
+	ASSERT_TRUE(in.send("gone", 4));
+	bool refused = false;
+	for (int i = 0; i < 100 && !refused; i++) {
+		refused = !in.send("gone", 4) && errno == ECONNREFUSED;
+	}
+	EXPECT_TRUE(refused);
+
+	// Free to talk to anyone again
+	ASSERT_TRUE(in.disconnect());
+	net::Address strangerAddr;
+	ASSERT_TRUE(stranger.localAddress(strangerAddr));
+	ASSERT_TRUE(in.sendto("hello", 5, strangerAddr));
+	ASSERT_TRUE(stranger.recvfrom(buf, sizeof(buf), received, from));
+	EXPECT_EQ(5u, received);
+}
@@ -0,0 +1,31 @@
+#include "narf/quantize.h"
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(Quantize, AllValues) {
+	std::vector<int16_t> in;
+	for (int32_t v = INT16_MIN; v <= INT16_MAX; v++) {
+		in.push_back((int16_t)v);
+	}
+	std::vector<int8_t> out(in.size());
+	narf::quantize16to8(in.data(), out.data(), in.size());
+	for (size_t i = 0; i < in.size(); i++) {
+		ASSERT_EQ((int8_t)(in[i] / 256), out[i]) << "for " << in[i];
+	}
+}
+
+TEST(Quantize, Tail) {
+	// Lengths around the vector width, and nothing written past count
+	const int16_t in[11] = {-32768, -257, -256, -255, -1, 0, 1, 255, 256, 32767, -512};
+	for (size_t n = 0; n <= 11; n++) {
+		int8_t out[12];
+		memset(out, 0x55, sizeof(out));
+		narf::quantize16to8(in, out, n);
+		for (size_t i = 0; i < n; i++) {
+			ASSERT_EQ((int8_t)(in[i] / 256), out[i]);
+		}
+		ASSERT_EQ(0x55, out[n]);
+	}
+}
@@ -0,0 +1,85 @@
+#include "narf/ringfile.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+static std::string tempRing() {
+	char name[] = "/tmp/narf-ringfile-XXXXXX";
+	int fd = mkstemp(name);
+	close(fd);
+	return name;
+}
+
+static std::vector<uint64_t> stamps(const narf::RingFile& rf) {
+	std::vector<uint64_t> v;
+	rf.forEach([&v](const narf::RingFile::Record& r) {
+		v.push_back(r.stamp);
+	});
+	return v;
+}
+
+TEST(RingFile, AppendRead) {
+	auto name = tempRing();
+	narf::RingFile rf;
+	ASSERT_TRUE(rf.open(name, 4096));
+	ASSERT_TRUE(rf.append(1, 100, "abc", 3));
+	ASSERT_TRUE(rf.append(2, 200, "defgh", 5));
+	int n = 0;
+	rf.forEach([&n](const narf::RingFile::Record& r) {
+		if (n == 0) {
+			ASSERT_EQ(1, r.type);
+			ASSERT_EQ(100u, r.stamp);
+			ASSERT_EQ(0, memcmp("abc", r.data, 3));
+		} else {
+			ASSERT_EQ(2, r.type);
+			ASSERT_EQ(5u, r.size);
+		}
+		n++;
+	});
+	ASSERT_EQ(2, n);
+	unlink(name.c_str());
+}
+
+TEST(RingFile, Wrap) {
+	auto name = tempRing();
+	narf::RingFile rf;
+	ASSERT_TRUE(rf.open(name, 1000)); // 40 byte records don't divide it evenly
+	uint8_t data[20] = {0};
+	for (uint64_t i = 0; i < 500; i++) {
+		ASSERT_TRUE(rf.append(0, i, data, sizeof(data)));
+	}
+	auto v = stamps(rf);
+	ASSERT_GE(v.size(), 20u);
+	ASSERT_LE(v.size(), 25u);
+	ASSERT_EQ(499u, v.back());
+	for (size_t i = 1; i < v.size(); i++) {
+		ASSERT_EQ(v[i - 1] + 1, v[i]);
+	}
+	ASSERT_FALSE(rf.append(0, 0, data, 300)); // Over a quarter of the ring
+	unlink(name.c_str());
+}
+
+TEST(RingFile, Reopen) {
+	auto name = tempRing();
+	{
+		narf::RingFile rf;
+		ASSERT_TRUE(rf.open(name, 4096));
+		rf.append(0, 1, "x", 1);
+		rf.append(0, 2, "y", 1);
+	}
+	narf::RingFile ro;
+	ASSERT_TRUE(ro.openReadOnly(name));
+	ASSERT_FALSE(ro.append(0, 3, "z", 1));
+	ASSERT_EQ(2u, stamps(ro).size());
+	ro.close();
+
+	narf::RingFile rf;
+	ASSERT_TRUE(rf.open(name, 4096)); // Same size keeps the history
+	rf.append(0, 3, "z", 1);
+	ASSERT_EQ(3u, stamps(rf).size());
+	ASSERT_TRUE(rf.open(name, 8192)); // Different size starts over
+	ASSERT_EQ(0u, stamps(rf).size());
+	unlink(name.c_str());
+}
@@ -0,0 +1,62 @@
+#include "narf/seqtracker.h"
+#include <gtest/gtest.h>
+
+typedef narf::SeqTracker::Result Result;
+
+TEST(SeqTracker, InOrder) {
+	narf::SeqTracker t;
+	ASSERT_EQ(Result::FIRST, t.add(10));
+	for (uint16_t i = 11; i < 100; i++) {
+		ASSERT_EQ(Result::NEXT, t.add(i));
+	}
+	ASSERT_EQ(90u, t.received());
+	ASSERT_EQ(0u, t.lost());
+	ASSERT_EQ(0u, t.bursts().count());
+}
+
+TEST(SeqTracker, GapsAndBursts) {
+	narf::SeqTracker t;
+	t.add(1);
+	ASSERT_EQ(Result::GAP, t.add(3));
+	ASSERT_EQ(Result::GAP, t.add(8));
+	ASSERT_EQ(5u, t.lost());
+	ASSERT_EQ(2u, t.bursts().count());
+	ASSERT_EQ(1u, t.bursts().bucket(1));
+	ASSERT_EQ(1u, t.bursts().bucket(4));
+}
+
+TEST(SeqTracker, LateAndDuplicate) {
+	narf::SeqTracker t;
+	t.add(1);
+	t.add(4);
+	ASSERT_EQ(2u, t.lost());
+	ASSERT_EQ(Result::LATE, t.add(2));
+	ASSERT_EQ(1u, t.lost());
+	ASSERT_EQ(1u, t.late());
+	ASSERT_EQ(Result::DUPLICATE, t.add(2));
+	ASSERT_EQ(Result::DUPLICATE, t.add(4));
+	ASSERT_EQ(2u, t.duplicates());
+	ASSERT_EQ(3u, t.received());
+}
+
+TEST(SeqTracker, Wraparound) {
+	narf::SeqTracker t;
+	t.add(0xfffe);
+	ASSERT_EQ(Result::NEXT, t.add(0xffff));
+	ASSERT_EQ(Result::NEXT, t.add(0));
+	ASSERT_EQ(Result::GAP, t.add(2));
+	ASSERT_EQ(Result::LATE, t.add(1));
+	ASSERT_EQ(Result::DUPLICATE, t.add(0xffff));
+	ASSERT_EQ(1u, t.wraps());
+	ASSERT_EQ(0u, t.lost());
+}
+
+TEST(SeqTracker, Stale) {
+	narf::SeqTracker t;
+	t.add(1000);
+	t.add(1100);
+	ASSERT_EQ(Result::STALE, t.add(1001));
+	ASSERT_EQ(1u, t.stale());
+	ASSERT_EQ(99u, t.lost());
+	ASSERT_EQ(1u, t.bursts().bucket(32)); // Past maxBurst lands in overflow
+}
@@ -0,0 +1,77 @@
+#include "narf/triplebuffer.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+
+struct Sample {
+	uint32_t a;
+	uint32_t b[15];
+};
+
+} // namespace
+
+TEST(TripleBuffer, Empty) {
+	narf::TripleBuffer<int> tb;
+	ASSERT_FALSE(tb.update());
+	ASSERT_EQ(0, tb.front());
+}
+
+TEST(TripleBuffer, Publish) {
+	narf::TripleBuffer<int> tb;
+	tb.back() = 5;
+	tb.publish();
+	ASSERT_TRUE(tb.update());
+	ASSERT_EQ(5, tb.front());
+	ASSERT_FALSE(tb.update());
+	ASSERT_EQ(5, tb.front());
+}
+
+TEST(TripleBuffer, NewestWins) {
+	narf::TripleBuffer<int> tb;
+	for (int i = 1; i <= 3; i++) {
+		tb.back() = i;
+		tb.publish();
+	}
+	ASSERT_TRUE(tb.update());
+	ASSERT_EQ(3, tb.front());
+	tb.back() = 4;
+	tb.publish();
+	ASSERT_EQ(3, tb.front());
+	ASSERT_TRUE(tb.update());
+	ASSERT_EQ(4, tb.front());
+}
+
+TEST(TripleBuffer, Threads) {
+	// The reader must only ever see whole samples, in order
+	narf::TripleBuffer<Sample> tb;
+	const uint32_t count = 200000;
+	std::thread writer([&]() {
+		for (uint32_t i = 1; i <= count; i++) {
+			auto& s = tb.back();
+			s.a = i;
+			for (auto& v : s.b) {
+				v = i;
+			}
+			tb.publish();
+		}
+	});
+	uint32_t last = 0;
+	bool torn = false, backwards = false;
+	while (last < count) {
+		if (!tb.update()) {
+			std::this_thread::yield();
+			continue;
+		}
+		auto& s = tb.front();
+		for (auto v : s.b) {
+			torn |= (v != s.a);
+		}
+		backwards |= (s.a <= last);
+		last = s.a;
+	}
+	writer.join();
+	ASSERT_FALSE(torn);
+	ASSERT_FALSE(backwards);
+	ASSERT_EQ(count, last);
+}
@@ -6,89 +6,237 @@
 
 #include "narf/tokenize.h"
 #include "net.h"
+#include <thread>
+#include <cstdio>
+#include <algorithm>
 
-Net::Net() : initializedIn(false), initializedOut(false) {
+Net::Net() : initializedIn(false), initializedOut(false), connected(false), kernelStamps(false) {
+#ifdef __linux__
+	memset(inMsgs, 0, sizeof(inMsgs));
+	for (size_t i = 0; i < RECV_BATCH; i++) {
+		inIov[i].iov_base = inBatch[i].data;
+		inIov[i].iov_len = BUFSIZE;
+		inMsgs[i].msg_hdr.msg_iov = &inIov[i];
+		inMsgs[i].msg_hdr.msg_iovlen = 1;
+		inMsgs[i].msg_hdr.msg_control = inCtrl[i];
+		inMsgs[i].msg_hdr.msg_name = &inBatch[i].fromRaw;
+	}
+	memset(outMsgs, 0, sizeof(outMsgs));
+#endif
+}
+
+std::unique_ptr<narf::net::Socket> Net::openSocket() {
+	std::unique_ptr<narf::net::Socket> sock(new narf::net::Socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP));
+	if (sock->valid() && sock->setV6Only(false)) {
+		return sock;
+	}
+	printf("No dual-stack IPv6 socket, using IPv4 only\n");
+	sock.reset(new narf::net::Socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+	if (!sock->valid()) {
+		perror("Socket");
+		return nullptr;
+	}
+	return sock;
 }
 
 void Net::initSocketIn() {
 	if (initializedIn) {
-		close(sockIn);
 		initializedIn = false;
+		connected = false;
+		sockIn.reset();
 	}
 
-	if ((sockIn = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
-		perror("Socket");
+	sockIn = openSocket();
+	if (!sockIn) {
 		return;
 	}
 
-	sockaddr_in sockIn_addr;
-	memset((char*) &sockIn_addr, 0, sizeof(sockIn_addr));
-	sockIn_addr.sin_family = AF_INET;
-	sockIn_addr.sin_port = htons(1150);
-	sockIn_addr.sin_addr.s_addr = INADDR_ANY;
+	narf::net::Address any;
+	if (sockIn->family() == AF_INET6) {
+		sockaddr_in6 addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin6_family = AF_INET6;
+		addr.sin6_addr = in6addr_any;
+		any = narf::net::Address(addr);
+	} else {
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = INADDR_ANY;
+		any = narf::net::Address(addr);
+	}
+	any.setPort(1150);
 
+	sockIn->setReuseAddr(true);
+	sockIn->setNonBlocking(true);
+#ifdef SO_TIMESTAMPNS
 	int val = 1;
-	setsockopt(sockIn, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(int));
-	fcntl(sockIn, F_SETFL, O_NONBLOCK);
-	if (bind(sockIn, (sockaddr*)&sockIn_addr, sizeof(sockIn_addr)) == -1) {
+	kernelStamps = (setsockopt(sockIn->sock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) == 0);
+#endif
+	if (!sockIn->bind(any)) {
 		perror("Bind");
-		close(sockIn);
+		sockIn.reset();
 		return;
 	}
 	initializedIn = true;
 }
 
-bool Net::initSocketOut(std::string host) {
-	if (initializedOut) {
-		close(sockOut);
-		initializedOut = false;
-	}
+bool Net::initSocketOut() {
+	initializedOut = false;
+	connected = false;
+	sockOut = openSocket();
+	target = narf::net::Address();
+	return sockOut != nullptr;
+}
 
-	addrinfo* result;
-	addrinfo hints;
+void Net::setTarget(const narf::net::Address& addr) {
+	target = addr;
+	initializedOut = true;
+}
 
-	memset((char*) &hints, 0, sizeof(hints));
-	hints.ai_family = AF_INET;
-	hints.ai_socktype = SOCK_DGRAM;
+bool Net::connect(const narf::net::Address& statusFrom) {
+	if (!initializedIn || !initializedOut) {
+		return false;
+	}
+	if (!sockOut->connect(target) || !sockIn->connect(statusFrom)) {
+		perror("Connect");
+		disconnect();
+		return false;
+	}
+	connected = true;
+	return true;
+}
 
-	while (getaddrinfo(host.c_str(), "1110", &hints, &result)) {
-		//perror("getaddrinfo");
+void Net::disconnect() {
+	if (sockOut) {
+		sockOut->disconnect();
 	}
+	if (sockIn) {
+		sockIn->disconnect();
+	}
+	connected = false;
+}
 
-	addrinfo* res;
-	for (res = result; res != NULL; res = res->ai_next) {
-		if ((sockOut = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1) {
-			continue;
-		}
-		break;
+int Net::send(const void* data, size_t size) {
+	if (!initializedOut) {
+		return 0;
 	}
+	bool ok = connected ? sockOut->send(data, size) : sockOut->sendto(data, size, target);
+	return ok ? (int)size : -1;
+}
 
-	memset((char*) &sockOut_addr, 0, sizeof(sockOut_addr));
-	if (res != NULL) {
-		memcpy(&sockOut_addr, res->ai_addr, res->ai_addrlen);
-		freeaddrinfo(result);
-		initializedOut = true;
+size_t Net::sendAll(const void* data, size_t size, const narf::net::Address* addrs, size_t count) {
+	if (!sockOut) {
+		return 0;
 	}
+	count = std::min(count, (size_t)SEND_FANOUT);
+#ifdef __linux__
+	outIov.iov_base = (void*)data;
+	outIov.iov_len = size;
+	for (size_t i = 0; i < count; i++) {
+		outAddrs[i] = sockOut->family() == AF_INET6 ? addrs[i].toV4Mapped() : addrs[i];
+		outMsgs[i].msg_hdr.msg_name = (void*)outAddrs[i].sockaddr();
+		outMsgs[i].msg_hdr.msg_namelen = outAddrs[i].sockaddrLen();
+		outMsgs[i].msg_hdr.msg_iov = &outIov;
+		outMsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	// sendmmsg() stops at the first failure, e.g. no route to one of them
+	size_t sent = 0;
+	size_t next = 0;
+	while (next < count) {
+		int rv = sendmmsg(sockOut->sock, &outMsgs[next], (unsigned)(count - next), 0);
+		if (rv <= 0) {
+			next++;
+		} else {
+			sent += (size_t)rv;
+			next += (size_t)rv;
+		}
+	}
+	return sent;
+#else
+	size_t sent = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (sockOut->sendto(data, size, addrs[i])) {
+			sent++;
+		}
+	}
+	return sent;
+#endif
+}
 
-	return initializedOut;
+size_t Net::recvBatch() {
+	if (!initializedIn) {
+		return 0;
+	}
+#ifdef __linux__
+	for (size_t i = 0; i < RECV_BATCH; i++) {
+		inMsgs[i].msg_hdr.msg_controllen = sizeof(inCtrl[i]);
+		inMsgs[i].msg_hdr.msg_namelen = sizeof(inBatch[i].fromRaw);
+	}
+	int rv = recvmmsg(sockIn->sock, inMsgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+	if (rv <= 0) {
+		return 0;
+	}
+	int64_t readAt = now();
+	for (int i = 0; i < rv; i++) {
+		inBatch[i].size = inMsgs[i].msg_len;
+		inBatch[i].stamp = readAt;
+		inBatch[i].from = narf::net::Address(inBatch[i].fromRaw).unmapped();
+		for (cmsghdr* c = CMSG_FIRSTHDR(&inMsgs[i].msg_hdr); c != NULL; c = CMSG_NXTHDR(&inMsgs[i].msg_hdr, c)) {
+			if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+				timespec ts;
+				memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+				inBatch[i].stamp = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+			}
+		}
+	}
+	return (size_t)rv;
+#else
+	size_t count = 0;
+	while (count < RECV_BATCH) {
+		size_t received;
+		if (!sockIn->recvfrom(inBatch[count].data, BUFSIZE, received, inBatch[count].from) || received == 0) {
+			break;
+		}
+		inBatch[count].from = inBatch[count].from.unmapped();
+		inBatch[count].stamp = now();
+		inBatch[count++].size = received;
+	}
+	return count;
+#endif
 }
 
-int Net::send(std::string data) {
-	if (initializedOut) {
-		return (int)sendto(sockOut, data.c_str(), data.size(), 0, (sockaddr*)&sockOut_addr, (uint32_t)sizeof(sockOut_addr));
+int64_t Net::now() {
+	if (kernelStamps) {
+		timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 	}
-	return 0;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-std::string Net::recv() {
-	if (initializedIn) {
-		char buf[BUFSIZE];
-		sockaddr_in sockOther;
-		socklen_t slen = sizeof(sockOther);
-		auto rv = recvfrom(sockIn, buf, BUFSIZE, 0, (sockaddr*)&sockOther, (socklen_t*)&slen);
-		if (rv > 0) {
-			return std::string(buf, rv);
-		}
+bool Net::wait(std::chrono::steady_clock::time_point deadline) {
+	auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+	if (left.count() < 0) {
+		left = std::chrono::nanoseconds(0);
 	}
-	return "";
+	if (!initializedIn) {
+		std::this_thread::sleep_for(left);
+		return false;
+	}
+
+	pollfd pfd;
+	pfd.fd = sockIn->sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+#ifdef __linux__
+	timespec ts;
+	ts.tv_sec = (time_t)(left.count() / 1000000000);
+	ts.tv_nsec = (long)(left.count() % 1000000000);
+	int rv = ppoll(&pfd, 1, &ts, NULL);
+#else
+	// poll() only has millisecond resolution, so round up rather than wake early
+	int rv = poll(&pfd, 1, (int)((left.count() + 999999) / 1000000));
+#endif
+	return rv > 0 && (pfd.revents & POLLIN);
 }
@@ -8,10 +8,17 @@
 #define _NET_H_
 
 #define BUFSIZE 1024
+#define RECV_BATCH 16
+#define SEND_FANOUT 16 // Most addresses sendAll() sends to at once
+
+#include "narf/net.h"
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
 #include <cstring>
+#include <poll.h>
 #include <fcntl.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -20,24 +27,73 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+struct Datagram {
+	uint8_t data[BUFSIZE];
+	size_t size;
+	int64_t stamp; // Arrival time in nanoseconds, on the same clock as Net::now()
+	narf::net::Address from; // IPv4 senders show up as plain IPv4, not mapped
+	sockaddr_storage fromRaw;
+};
+
 class Net {
 	private:
 		std::atomic_bool initializedIn;
 		std::atomic_bool initializedOut;
-		int sockIn;
-		int sockOut;
-		sockaddr_in sockOut_addr;
+		// IPv6 with IPv4 mapped in where the OS allows it, so one socket each
+		// way reaches the roboRIO whichever it answers on. IPv4 only otherwise.
+		std::unique_ptr<narf::net::Socket> sockIn;
+		std::unique_ptr<narf::net::Socket> sockOut;
+		narf::net::Address target;
+		std::atomic_bool connected; // Both sockets connect()ed to the roboRIO, see connect()
+		narf::net::Address outAddrs[SEND_FANOUT]; // sendAll()'s, as sockOut wants them
 
-		std::atomic_flag connecting;
-		bool connected;
+		bool kernelStamps;
+
+		Datagram inBatch[RECV_BATCH];
+#ifdef __linux__
+		mmsghdr inMsgs[RECV_BATCH];
+		iovec inIov[RECV_BATCH];
+		char inCtrl[RECV_BATCH][CMSG_SPACE(sizeof(timespec))];
+		mmsghdr outMsgs[SEND_FANOUT];
+		iovec outIov;
+#endif
+
+		static std::unique_ptr<narf::net::Socket> openSocket();
 
 	public:
 		Net();
 		void initSocketIn();
-		bool initSocketOut(std::string host);
+		bool initSocketOut();
+		// Where send() goes. Only call from the thread that sends.
+		void setTarget(const narf::net::Address& addr);
+		const narf::net::Address& getTarget() { return target; }
+		// Tie sockOut to the target and sockIn to where status comes from, so
+		// send() skips the address lookup, the kernel drops stray packets, and
+		// if nothing is listening on the target send() fails with ECONNREFUSED
+		// instead of the packets silently going nowhere.
+		bool connect(const narf::net::Address& statusFrom);
+		void disconnect();
+		bool isConnected() { return connected; }
+
+		// Block until the input socket is readable or deadline passes.
+		// Returns true if there's data waiting.
+		bool wait(std::chrono::steady_clock::time_point deadline);
+		// -1 with errno set if it failed
+		int send(const void* data, size_t size);
+		// Send the same datagram to each address, in one system call where
+		// there's sendmmsg(). One that can't be reached doesn't stop the
+		// rest. Returns how many went out.
+		size_t sendAll(const void* data, size_t size, const narf::net::Address* addrs, size_t count);
+		// Read up to RECV_BATCH queued datagrams in one go, without blocking.
+		// Returns how many were read; they stay valid until the next call.
+		size_t recvBatch();
+		const Datagram& getDatagram(size_t idx) { return inBatch[idx]; }
 
-		int send(std::string data);
-		std::string recv();
+		// Receive stamps come from the kernel (SO_TIMESTAMPNS, wall clock) when
+		// the socket supports it, otherwise from steady_clock when we read them.
+		// now() reads whichever clock the stamps are on so the two can be compared.
+		int64_t now();
+		bool hasKernelStamps() { return kernelStamps; }
 };
 
 #endif /* _NET_H_ */
@@ -0,0 +1,132 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "realtime.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
+static int reservedCore = -1; // Set by avoidCore()
+
+int getCoreCount() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+
+#ifdef __linux__
+
+static bool setAffinity(const cpu_set_t& set) {
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (err != 0) {
+		printf("Couldn't set CPU affinity: %s\n", strerror(err));
+		return false;
+	}
+	return true;
+}
+
+bool pinThread(int core) {
+	if (core < 0 || core >= getCoreCount() || core >= CPU_SETSIZE) {
+		printf("Can't pin to core %d, there are %d\n", core, getCoreCount());
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	return setAffinity(set);
+}
+
+bool avoidCore(int core) {
+	int count = getCoreCount();
+	if (count < 2) {
+		printf("Only one core, everything has to share it\n");
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int i = 0; i < count && i < CPU_SETSIZE; i++) {
+		if (i != core) {
+			CPU_SET(i, &set);
+		}
+	}
+	if (!setAffinity(set)) {
+		return false;
+	}
+	reservedCore = core;
+	return true;
+}
+
+bool setRealtimePriority(int priority) {
+	sched_param param;
+	memset(&param, 0, sizeof(param));
+	int policy = SCHED_OTHER;
+	if (priority > 0) {
+		policy = SCHED_FIFO;
+		param.sched_priority = priority;
+		int max = sched_get_priority_max(SCHED_FIFO);
+		if (priority > max) {
+			param.sched_priority = max;
+		}
+	}
+	int err = pthread_setschedparam(pthread_self(), policy, &param);
+	if (err != 0) {
+		// Usually EPERM: needs CAP_SYS_NICE or an rtprio entry in limits.conf
+		printf("Couldn't set SCHED_FIFO priority %d: %s\n", priority, strerror(err));
+		return false;
+	}
+	return true;
+}
+
+void leaveRealtime() {
+	if (reservedCore >= 0) {
+		avoidCore(reservedCore);
+	}
+	int policy;
+	sched_param param;
+	if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy != SCHED_OTHER) {
+		setRealtimePriority(0);
+	}
+}
+
+bool lockMemory() {
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		perror("mlockall");
+		return false;
+	}
+	return true;
+}
+
+#else
+
+bool pinThread(int core) {
+	printf("CPU pinning isn't supported on this platform\n");
+	return false;
+}
+
+bool avoidCore(int core) {
+	return false;
+}
+
+bool setRealtimePriority(int priority) {
+	if (priority > 0) {
+		printf("Real-time priority isn't supported on this platform\n");
+	}
+	return false;
+}
+
+void leaveRealtime() {
+}
+
+bool lockMemory() {
+	printf("Memory locking isn't supported on this platform\n");
+	return false;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+// Scheduling controls for keeping the control loop on its 20 ms cadence when
+// the machine is busy. Each call only affects the calling thread, and threads
+// it starts afterwards inherit the setting. They all print why and return
+// false if the OS refuses, and nothing breaks if they do.
+
+int getCoreCount();
+// Only run the calling thread on core
+bool pinThread(int core);
+// Run the calling thread on any core except this one
+bool avoidCore(int core);
+// SCHED_FIFO at priority 1-99, or back to the normal scheduler for 0
+bool setRealtimePriority(int priority);
+// For helper threads started from the control loop: back to the normal
+// scheduler, and off the core avoidCore() set aside if there is one
+void leaveRealtime();
+// Lock current and future pages in RAM so the loop never waits on a page fault
+bool lockMemory();
+
+#endif /* _REALTIME_H_ */
@@ -0,0 +1,133 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "resolver.h"
+#include "realtime.h"
+#include "narf/file.h"
+#include "narf/format.h"
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+Resolver::Resolver() {
+}
+
+void Resolver::init(uint16_t teamNum, const std::string& staticHost, const std::string& cacheFile) {
+	this->cacheFile = cacheFile;
+	candidates.clear();
+	cached.clear();
+	narf::MemoryFile file;
+	if (cacheFile.size() > 0 && file.read(cacheFile)) {
+		cached = file.str();
+		cached.erase(cached.find_last_not_of(" \t\r\n") + 1);
+		if (cached.size() > 0) {
+			add(cached, "cached");
+		}
+	}
+	if (staticHost.size() > 0) {
+		add(staticHost, "static");
+	}
+	add(narf::util::format("roborio-%d.local", teamNum), "mDNS");
+	add(narf::util::format("10.%d.%d.2", teamNum / 100, teamNum % 100), "radio");
+	add("172.22.11.2", "USB");
+}
+
+void Resolver::add(const std::string& host, const char* source) {
+	for (auto& c : candidates) {
+		if (c.host == host) {
+			return;
+		}
+	}
+	Candidate c;
+	c.host = host;
+	c.source = source;
+	c.resolved = false;
+	c.stale = false;
+	c.failures = 0;
+	candidates.push_back(c);
+}
+
+bool Resolver::update() {
+	bool changed = false;
+	auto now = std::chrono::steady_clock::now();
+	for (auto& c : candidates) {
+		if (c.pending) {
+			if (!c.pending->done) {
+				continue;
+			}
+			if (c.pending->ok) {
+				changed |= !c.resolved || c.addrs != c.pending->addrs;
+				c.addrs = c.pending->addrs;
+				c.resolved = true;
+				c.stale = false;
+				c.failures = 0;
+			} else {
+				std::chrono::milliseconds wait = RESOLVE_RETRY_MIN * (1 << std::min(c.failures, 5u));
+				c.nextTry = now + std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(RESOLVE_RETRY_MAX));
+				c.failures++;
+			}
+			c.pending.reset();
+		}
+		if ((!c.resolved || c.stale) && now >= c.nextTry) {
+			// Detached, so a lookup that never returns can't hold up exit
+			c.pending = std::make_shared<Lookup>();
+			std::thread(lookup, c.pending, c.host).detach();
+		}
+	}
+	return changed;
+}
+
+void Resolver::refresh() {
+	for (auto& c : candidates) {
+		c.stale = c.resolved;
+		c.failures = 0;
+		c.nextTry = std::chrono::steady_clock::time_point();
+	}
+}
+
+void Resolver::remember(const narf::net::Address& addr) {
+	// Link-local IPv6 keeps its %interface, which getaddrinfo() reads back
+	std::string host = addr.toString();
+	if (cacheFile.size() == 0 || host.size() == 0) {
+		return;
+	}
+	if (cached == host) {
+		return;
+	}
+	cached = host;
+	narf::MemoryFile file;
+	file.setData(host + "\n");
+	if (!file.write(cacheFile)) {
+		printf("Failed writing %s\n", cacheFile.c_str());
+	}
+}
+
+void Resolver::lookup(std::shared_ptr<Lookup> l, std::string host) {
+	leaveRealtime(); // Started from the control loop
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC; // Not AI_ADDRCONFIG, it would drop link-local-only IPv6
+	hints.ai_socktype = SOCK_DGRAM;
+	std::vector<narf::net::AddrInfo> results;
+	if (narf::net::getaddrinfo(host.c_str(), "1110", &hints, results)) {
+		for (auto& r : results) {
+			auto& addr = r.getAddress();
+			if (addr.family() != AF_INET && addr.family() != AF_INET6) {
+				continue;
+			}
+			bool dup = false;
+			for (auto& a : l->addrs) {
+				dup |= a.sameHost(addr);
+			}
+			if (!dup) {
+				l->addrs.push_back(addr);
+			}
+		}
+		l->ok = !l->addrs.empty();
+	}
+	l->done = true;
+}
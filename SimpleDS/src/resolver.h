@@ -0,0 +1,69 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _RESOLVER_H_
+#define _RESOLVER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "narf/net.h"
+
+#define RESOLVE_RETRY_MIN std::chrono::milliseconds(250)
+#define RESOLVE_RETRY_MAX std::chrono::seconds(8)
+
+// Finds the addresses the roboRIO might be at: the one it last answered
+// from, a configured one, its mDNS name, the radio address and USB. Each
+// name is looked up on a thread of its own so a slow mDNS query doesn't
+// hold up the rest, and failures are retried with exponential backoff.
+// Names resolve to every IPv4 and IPv6 address they have, in one query, so a
+// link-local mDNS answer that lists its AAAA first is as good as an A.
+// Everything except the lookups happens on whichever thread calls update().
+class Resolver {
+	private:
+		struct Lookup {
+			std::atomic_bool done;
+			bool ok;
+			std::vector<narf::net::Address> addrs;
+			Lookup() : done(false), ok(false) { }
+		};
+
+	public:
+		struct Candidate {
+			std::string host;
+			const char* source; // Where the host came from, for display
+			bool resolved;
+			bool stale; // Being looked up again; addrs stay in use until the answer comes
+			std::vector<narf::net::Address> addrs; // Port 1110
+			unsigned failures; // In a row
+			std::chrono::steady_clock::time_point nextTry;
+			std::shared_ptr<Lookup> pending;
+		};
+
+		Resolver();
+		void init(uint16_t teamNum, const std::string& staticHost, const std::string& cacheFile);
+		// Collects finished lookups and starts any that are due. Returns true
+		// if a candidate resolved to a new address.
+		bool update();
+		// Looks everything up again, e.g. after comms drop. Whatever has
+		// already resolved keeps its addresses until the new lookup is in.
+		void refresh();
+		// Saves where the robot answered from, to try first next time
+		void remember(const narf::net::Address& addr);
+		const std::vector<Candidate>& getCandidates() { return candidates; }
+
+	private:
+		std::vector<Candidate> candidates;
+		std::string cacheFile;
+		std::string cached; // What cacheFile holds
+
+		void add(const std::string& host, const char* source);
+		static void lookup(std::shared_ptr<Lookup> l, std::string host);
+};
+
+#endif /* _RESOLVER_H_ */
@@ -22,6 +22,26 @@ void ScreenMain::draw(GUI* gui) {
 }
 
 void ScreenInfo::draw(GUI* gui) {
+	if (page == NETWORK) {
+		drawNetwork(gui);
+	} else {
+		drawRoboRIO(gui);
+	}
+	gui->drawText(60, 0, narf::util::format("<- %d/%d ->", page + 1, COUNT), Colors::DISABLED);
+}
+
+void ScreenInfo::update(SDL_Event e) {
+	if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
+		auto key = e.key.keysym;
+		if (key.sym == SDLK_RIGHT) {
+			page = (uint8_t)((page + 1) % COUNT);
+		} else if (key.sym == SDLK_LEFT) {
+			page = (uint8_t)((page + COUNT - 1) % COUNT);
+		}
+	}
+}
+
+void ScreenInfo::drawRoboRIO(GUI* gui) {
 	auto ds = DS::getInstance();
 	if (ds->isConnected()) {
 		gui->drawText(0, 0, "Versions:");
@@ -43,6 +63,40 @@ void ScreenInfo::draw(GUI* gui) {
 	}
 }
 
+void ScreenInfo::drawNetwork(GUI* gui) {
+	// 17 px rows from y = 10 put row 7 under the tab bar, so this stays within rows 0-6
+	auto ds = DS::getInstance();
+	auto& rtt = ds->getRTT();
+	gui->drawText(0, 0, narf::util::format("Round Trip (%s timestamps):", ds->hasKernelStamps() ? "kernel" : "userspace"));
+	gui->drawText(36, 0, "d: Dump stats to file", Colors::DISABLED);
+	gui->drawTextRel(1, 1, narf::util::format("min %5d us   avg %7.0f us   p99 %6d us   max %6d us   (%llu)",
+				(int)rtt.min(), rtt.mean(), (int)rtt.percentile(99), (int)rtt.max(), (unsigned long long)rtt.count()));
+	auto& echoes = ds->getEchoes();
+	gui->drawText(0, 2, narf::util::format("Packets: Lost %llu (%u/s)   Late %llu   Dup %llu   Stale %llu   Wraps %llu",
+				(unsigned long long)echoes.lost(), ds->getLossRate(), (unsigned long long)echoes.late(),
+				(unsigned long long)echoes.duplicates(), (unsigned long long)echoes.stale(), (unsigned long long)echoes.wraps()));
+	auto& bursts = echoes.bursts();
+	gui->drawText(9, 3, narf::util::format("Bursts %llu   avg %.1f   p99 %d   max %d",
+				(unsigned long long)bursts.count(), bursts.mean(), (int)bursts.percentile(99), (int)bursts.max()),
+			ds->getLossRate() ? Colors::RED : Colors::BLACK);
+	gui->drawText(54, 3, narf::util::format("Coalesced: %llu", (unsigned long long)ds->getCoalesced()));
+	auto& jitter = ds->getSendJitter();
+	gui->drawText(0, 4, narf::util::format("Send Jitter: avg %4.0f  p99 %5d  max %5d us",
+				jitter.mean(), (int)jitter.percentile(99), (int)jitter.max()));
+	gui->drawText(49, 4, narf::util::format("Frames: %llu, %llu idle, p99 %d us",
+				(unsigned long long)gui->getFramesDrawn(), (unsigned long long)gui->getFramesSkipped(),
+				(int)gui->getFrameTimes().percentile(99)), Colors::DISABLED);
+	auto& watchdog = ds->getWatchdog();
+	gui->drawText(0, 5, narf::util::format("Comms drops: %u   longest %lld ms   (lost after %u missed)",
+				(unsigned)watchdog.getLosses(), (long long)watchdog.getLongestOutage(), (unsigned)watchdog.getThreshold()),
+			watchdog.getState() == Watchdog::State::LOST ? Colors::RED : Colors::BLACK);
+	if (ds->getFindTime() >= 0) {
+		gui->drawText(0, 6, narf::util::format("Robot: %s, found in %lld ms", ds->getTargetText().c_str(), (long long)ds->getFindTime()));
+	} else {
+		gui->drawText(0, 6, "Robot: looking");
+	}
+}
+
 void ScreenJoysticks::draw(GUI* gui) {
 	auto ds = DS::getInstance();
 	auto joysticks = ds->getJoysticks();
@@ -70,6 +124,10 @@ void ScreenJoysticks::draw(GUI* gui) {
 	if (joysticks.size() > 0 && idx < joysticks.size()) {
 		gui->drawTextRel(0, 0, joysticks[idx]->toString());
 		gui->drawTextRel(0, 1, std::string("GUID: ") + joysticks[idx]->getGUID());
+		auto& lag = ds->getInputLatency(idx);
+		// Row 6, the last one above the tab bar
+		gui->drawTextRel(0, 1, narf::util::format("Input lag: p50 %d, p99 %d, max %d us", (int)lag.percentile(50),
+				(int)lag.percentile(99), (int)lag.max()), Colors::DISABLED);
 	}
 }
 
@@ -128,6 +186,7 @@ void ScreenHelp::draw(GUI* gui) {
 	gui->drawTextRel(0, 1, "Space   : Disable");
 	gui->drawTextRel(0, 1, "r       : Restart Code");
 	gui->drawTextRel(0, 1, "R       : Reboot RoboRIO");
+	gui->drawTextRel(0, 1, "d       : Dump Stats");
 	gui->drawText(56, 1, "`       : Toggle Color");
 	gui->drawTextRel(0, 1, "Ctrl-1  : Position 1");
 	gui->drawTextRel(0, 1, "Ctrl-2  : Position 2");
@@ -27,8 +27,15 @@ class ScreenMain : public Screen {
 };
 
 class ScreenInfo : public Screen {
+	private:
+		enum Page { ROBORIO, NETWORK, COUNT };
+		uint8_t page;
+		void drawRoboRIO(GUI* gui);
+		void drawNetwork(GUI* gui);
 	public:
+		ScreenInfo() : page(ROBORIO) {}
 		void draw(GUI* gui);
+		void update(SDL_Event e) override;
 };
 
 class ScreenJoysticks : public Screen {
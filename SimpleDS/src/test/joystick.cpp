@@ -0,0 +1,246 @@
+#include "joystick.h"
+#include "narf/bytestream.h"
+#include "narf/quantize.h"
+#include "narflib/test/alloccount.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+
+static Joystick::State emptyState() {
+	Joystick::State st;
+	memset(&st, 0, sizeof(st));
+	return st;
+}
+
+TEST(Joystick, Block) {
+	// 2 axes, 10 buttons with 1, 3 and 10 down, one hat pointing right
+	auto st = emptyState();
+	st.numAxes = 2;
+	st.axes[0] = -128;
+	st.axes[1] = 127;
+	st.numButtons = 10;
+	st.buttons[0] = 0x05;
+	st.buttons[1] = 0x02;
+	st.numHats = 1;
+	st.hats[0] = 90;
+	uint8_t buf[64];
+	narf::ByteWriter w(buf, sizeof(buf));
+	Joystick::makePacket(st, w);
+	const uint8_t expected[] = {
+		0x0a, 0x0c,
+		0x02, 0x80, 0x7f,
+		0x0a, 0x02, 0x05,
+		0x01, 0x00, 0x5a,
+	};
+	ASSERT_EQ(sizeof(expected), w.size());
+	ASSERT_EQ(0, memcmp(expected, buf, sizeof(expected)));
+}
+
+TEST(Joystick, Hats) {
+	// POVs are big-endian int16s like every other multi-byte field
+	auto st = emptyState();
+	st.numHats = 4;
+	st.hats[0] = 90;
+	st.hats[1] = -1; // Centered
+	st.hats[2] = 315;
+	st.hats[3] = 0;
+	uint8_t buf[64];
+	narf::ByteWriter w(buf, sizeof(buf));
+	Joystick::makePacket(st, w);
+	const uint8_t expected[] = {
+		0x0c, 0x0c,
+		0x00,
+		0x00,
+		0x04, 0x00, 0x5a, 0xff, 0xff, 0x01, 0x3b, 0x00, 0x00,
+	};
+	ASSERT_EQ(sizeof(expected), w.size());
+	ASSERT_EQ(0, memcmp(expected, buf, sizeof(expected)));
+}
+
+TEST(Joystick, MaxBlock) {
+	auto st = emptyState();
+	st.numAxes = JS_MAX_AXES;
+	st.numButtons = JS_MAX_BUTTONS;
+	st.numHats = JS_MAX_HATS;
+	memset(st.buttons, 0xff, sizeof(st.buttons));
+	uint8_t buf[JS_BLOCK_MAX];
+	narf::ByteWriter w(buf, sizeof(buf));
+	Joystick::makePacket(st, w);
+	ASSERT_FALSE(w.overran());
+	ASSERT_EQ((size_t)JS_BLOCK_MAX, w.size());
+	ASSERT_EQ(JS_BLOCK_MAX - 1, buf[0]);
+	// 255 buttons: the first (most significant) byte only has 7 in use
+	ASSERT_EQ(0x7f, buf[3 + JS_MAX_AXES + 1]);
+	ASSERT_EQ(0xff, buf[3 + JS_MAX_AXES + 2]);
+}
+
+// Joystick block the way the DS used to build it: a ByteStream per
+// joystick, appended into a string. Hats BE, as the protocol has them.
+static std::string joystickStream(const int8_t* axes, uint16_t buttons, const int16_t* hats) {
+	narf::ByteStream s;
+	s.write((uint8_t)0x00);
+	s.write((uint8_t)0x0c);
+	s.write((uint8_t)6);
+	for (int i = 0; i < 6; i++) {
+		s.write(axes[i]);
+	}
+	s.write((uint8_t)12);
+	s.write(buttons, BE);
+	s.write((uint8_t)1);
+	s.write(hats[0], BE);
+	auto v = s.str();
+	v[0] = (uint8_t)(v.size() - 1);
+	return v;
+}
+
+TEST(Joystick, Benchmark) {
+	const int iterations = 200000;
+	const int8_t axes[6] = {0, -127, 127, 12, -12, 64};
+	const int16_t hats[1] = {90};
+	const uint16_t pressed = 0x0a5a;
+	uint16_t seqNum = 0;
+
+	// Old DS::makePacket(): one ByteStream for the header, one per joystick
+	std::string before;
+	auto allocs = allocCount();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		narf::ByteStream s;
+		s.write(seqNum++, BE);
+		s.write((uint8_t)0x01);
+		s.write((uint8_t)0x04);
+		s.write((uint8_t)0x00);
+		s.write((uint8_t)0x00);
+		before = s.str();
+		for (int j = 0; j < 6; j++) {
+			before += joystickStream(axes, pressed, hats);
+		}
+	}
+	auto streamNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto streamAllocs = allocCount() - allocs;
+
+	// Now: fixed-size State into one ByteWriter, as DS::makePacket() does
+	auto st = emptyState();
+	st.numAxes = 6;
+	memcpy(st.axes, axes, sizeof(axes));
+	st.numButtons = 12;
+	st.buttons[0] = (uint8_t)pressed;
+	st.buttons[1] = (uint8_t)(pressed >> 8);
+	st.numHats = 1;
+	st.hats[0] = hats[0];
+	uint8_t buf[1024];
+	narf::ByteWriter w(buf, sizeof(buf));
+	seqNum = 0;
+	allocs = allocCount();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		w.clear();
+		w.write(seqNum++, BE);
+		w.write((uint8_t)0x01);
+		w.write((uint8_t)0x04);
+		w.write((uint8_t)0x00);
+		w.write((uint8_t)0x00);
+		for (int j = 0; j < 6; j++) {
+			Joystick::makePacket(st, w);
+		}
+	}
+	auto writerNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto writerAllocs = allocCount() - allocs;
+
+	printf("Control packet, ByteStream          : %6.1f ns/packet, %5.2f allocs/packet\n", (double)streamNs / iterations, (double)streamAllocs / iterations);
+	printf("Control packet, Joystick::makePacket : %6.1f ns/packet, %5.2f allocs/packet\n", (double)writerNs / iterations, (double)writerAllocs / iterations);
+	ASSERT_EQ(before.size(), w.size());
+	ASSERT_EQ(0, memcmp(before.data(), buf, w.size()));
+	ASSERT_EQ(0u, writerAllocs);
+}
+
+// Joystick block the way the DS used to build it, from per-device
+// vectors sampled every period
+struct VectorStick {
+	std::vector<int8_t> axes;
+	std::vector<bool> buttons;
+	std::vector<int16_t> hats;
+};
+
+static void writeVector(narf::ByteWriter& w, const VectorStick& js) {
+	size_t start = w.tell();
+	w.write((uint8_t)0x00);
+	w.write((uint8_t)0x0c);
+	w.write((uint8_t)js.axes.size());
+	w.write(js.axes.data(), js.axes.size());
+	uint8_t numButtons = (uint8_t)js.buttons.size();
+	w.write(numButtons);
+	uint16_t b = 0;
+	for (uint8_t i = 0; i < numButtons; i++) {
+		b = (uint16_t)((b << 1) | js.buttons[numButtons - i - 1]);
+	}
+	w.write(b, BE);
+	w.write((uint8_t)js.hats.size());
+	for (auto h : js.hats) {
+		w.write(h, BE);
+	}
+	w.patch(start, (uint8_t)(w.tell() - start - 1));
+}
+
+TEST(Joystick, SampleBenchmark) {
+	// Sample six 6-axis, 12-button, 1-hat joysticks and serialize them, both ways
+	const int iterations = 200000;
+	const int16_t raw[6] = {0, -32768, 32767, 3100, -3100, 16400};
+	const uint16_t pressed = 0x0a5a;
+	uint8_t before[512], after[512];
+	narf::ByteWriter vw(before, sizeof(before)), pw(after, sizeof(after));
+
+	VectorStick vs[6];
+	for (auto& js : vs) {
+		js.axes.resize(6);
+		js.buttons.resize(12);
+		js.hats.resize(1);
+	}
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		vw.clear();
+		for (auto& js : vs) {
+			for (size_t a = 0; a < js.axes.size(); a++) {
+				js.axes[a] = (int8_t)(raw[a] / 256);
+			}
+			for (size_t b = 0; b < js.buttons.size(); b++) {
+				js.buttons[b] = ((pressed >> b) & 1) != 0;
+			}
+			js.hats[0] = 90;
+			writeVector(vw, js);
+		}
+	}
+	auto vectorNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	// Now: quantized straight into a State, encoded by Joystick::makePacket()
+	Joystick::State st[6];
+	for (auto& js : st) {
+		js = emptyState();
+		js.numAxes = 6;
+		js.numButtons = 12;
+		js.numHats = 1;
+	}
+	auto allocs = allocCount();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		pw.clear();
+		for (auto& js : st) {
+			narf::quantize16to8(raw, js.axes, js.numAxes);
+			js.buttons[0] = (uint8_t)pressed;
+			js.buttons[1] = (uint8_t)((pressed >> 8) & 0x0f);
+			js.hats[0] = 90;
+			Joystick::makePacket(js, pw);
+		}
+	}
+	auto stateNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto stateAllocs = allocCount() - allocs;
+
+	printf("6 joysticks, vectors : %6.1f ns/packet\n", (double)vectorNs / iterations);
+	printf("6 joysticks, State   : %6.1f ns/packet\n", (double)stateNs / iterations);
+	ASSERT_EQ(vw.size(), pw.size());
+	ASSERT_EQ(0, memcmp(before, after, vw.size()));
+	ASSERT_EQ(0u, stateAllocs);
+}
@@ -0,0 +1,9 @@
+#include <stdio.h>
+#include <gtest/gtest.h>
+
+int main(int argc, char **argv)
+{
+	printf("SimpleDS unit tests\n");
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+#include "RoboRIO.h"
+#include "narf/bytestream.h"
+#include "narflib/test/alloccount.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <gtest/gtest.h>
+
+// Sample roboRIO status packet: header plus one of each tagged structure
+static std::string statusPacket() {
+	narf::ByteStream bs;
+	bs.write((uint16_t)1234, BE);
+	bs.write((uint8_t)0x01);
+	bs.write((uint16_t)0x2004, BE);
+	bs.write((uint16_t)0x0c80, BE);
+	bs.write((uint8_t)0x00);
+	for (int i = 0; i < 2; i++) { // Joystick outputs
+		bs.write((uint8_t)9);
+		bs.write((uint8_t)0x01);
+		bs.write((uint32_t)0x12345678, BE);
+		bs.write((uint16_t)100, BE);
+		bs.write((uint16_t)200, BE);
+	}
+	bs.write((uint8_t)8); // Disk
+	bs.write((uint8_t)0x04);
+	bs.write((uint8_t)0);
+	bs.write((uint16_t)0);
+	bs.write((uint32_t)123456, BE);
+	bs.write((uint8_t)34); // CPU
+	bs.write((uint8_t)0x05);
+	bs.write((uint8_t)2);
+	for (int i = 0; i < 2; i++) {
+		bs.write(12.5f, BE);
+		bs.write(std::string(12, '\0'));
+	}
+	bs.write((uint8_t)8); // RAM
+	bs.write((uint8_t)0x06);
+	bs.write((uint8_t)0);
+	bs.write((uint16_t)0);
+	bs.write((uint32_t)654321, BE);
+	bs.write((uint8_t)15); // CAN
+	bs.write((uint8_t)0x0e);
+	bs.write(std::string(9, '\0'));
+	bs.write(std::string("\x2a\x01\x02\x03\x04", 5));
+	bs.write((uint8_t)3); // Unknown
+	bs.write((uint8_t)0x7f);
+	bs.write((uint16_t)0xffff);
+	return bs.str();
+}
+
+TEST(RoboRIO, StatusPacket) {
+	auto pkt = statusPacket();
+	RoboRIO rio;
+	rio.parsePacket(pkt.data(), pkt.size());
+	ASSERT_EQ(1234, rio.packet.seqNum);
+	ASSERT_EQ(2, rio.jsOutIdx);
+	ASSERT_EQ(0x12345678u, rio.outputs[1].outputs);
+	ASSERT_EQ(100, rio.outputs[1].rumbleLeft);
+	ASSERT_EQ(200, rio.outputs[1].rumbleRight);
+	ASSERT_EQ(123456u, rio.usage.disk);
+	ASSERT_EQ(654321u, rio.usage.ram);
+	ASSERT_EQ(12.5f, rio.cpus[1]);
+	ASSERT_EQ(42, rio.can.util);
+	ASSERT_EQ(4, rio.can.transmit);
+	ASSERT_EQ(12, (int)rio.getBattery());
+}
+
+TEST(RoboRIO, Truncated) {
+	// A tag claiming more than is left stops the walk without reading past the end
+	auto pkt = statusPacket();
+	RoboRIO rio;
+	rio.parsePacket(pkt.data(), 8 + 5);
+	ASSERT_EQ(1234, rio.packet.seqNum);
+	rio.parsePacket(pkt.data(), 4); // Too short to be a status packet, ignored
+	ASSERT_EQ(1234, rio.packet.seqNum);
+}
+
+TEST(RoboRIO, Benchmark) {
+	const int iterations = 200000;
+	auto pkt = statusPacket();
+	RoboRIO rio;
+	uint16_t seqNum = 0;
+
+	// Old approach: copy into a ByteStream, then substr() each tag
+	auto allocs = allocCount();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		std::string data(pkt);
+		auto reader = narf::ByteStream(data.c_str(), 8);
+		seqNum = reader.readU16(BE);
+		size_t offset = 8;
+		while (offset < data.size()) {
+			std::string rest = data.substr(offset);
+			narf::ByteStream tag(rest.c_str(), rest.size());
+			offset += tag.readU8() + 1u;
+		}
+	}
+	auto copyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto copyAllocs = allocCount() - allocs;
+
+	allocs = allocCount();
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		rio.parsePacket(pkt.data(), pkt.size());
+	}
+	auto viewNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	auto viewAllocs = allocCount() - allocs;
+
+	printf("Status parse, copying  : %6.1f ns/packet, %5.2f allocs/packet\n", (double)copyNs / iterations, (double)copyAllocs / iterations);
+	printf("RoboRIO::parsePacket   : %6.1f ns/packet, %5.2f allocs/packet\n", (double)viewNs / iterations, (double)viewAllocs / iterations);
+	ASSERT_EQ(seqNum, rio.packet.seqNum);
+	ASSERT_EQ(0u, viewAllocs);
+}
@@ -0,0 +1,89 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#include "watchdog.h"
+#include <cstdio>
+
+Watchdog::Watchdog(std::chrono::nanoseconds period, uint32_t threshold) : period(period), threshold(threshold), state(State::WAITING), losses(0), longestOutage(0), eventCount(0) {
+	started = std::chrono::steady_clock::now();
+}
+
+void Watchdog::setThreshold(uint32_t threshold) {
+	this->threshold = threshold > 0 ? threshold : 1;
+}
+
+bool Watchdog::feed(std::chrono::steady_clock::time_point now) {
+	auto previous = lastFed;
+	lastFed = now;
+	State s = state;
+	if (s == State::UP || !transition(s, State::UP)) {
+		return false;
+	}
+	upSince = now;
+	if (s == State::WAITING) {
+		log(false, now - started, 0);
+		return true;
+	}
+	auto out = now - previous;
+	auto outMs = std::chrono::duration_cast<std::chrono::milliseconds>(out).count();
+	if (outMs > longestOutage) {
+		longestOutage = outMs;
+	}
+	log(false, out, 0);
+	printf("Comms back after %lld ms\n", (long long)outMs);
+	return true;
+}
+
+bool Watchdog::check(std::chrono::steady_clock::time_point now) {
+	if (state != State::UP) {
+		return false;
+	}
+	auto missed = (now - lastFed) / period;
+	if (missed < threshold) {
+		return false;
+	}
+	if (!transition(State::UP, State::LOST)) {
+		return false;
+	}
+	losses++;
+	log(true, lastFed - upSince, (uint32_t)missed);
+	printf("Comms lost: no status for %u periods, after %lld ms up\n", (unsigned)missed,
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(lastFed - upSince).count());
+	return true;
+}
+
+bool Watchdog::trip(std::chrono::steady_clock::time_point now) {
+	if (!transition(State::UP, State::LOST)) {
+		return false;
+	}
+	losses++;
+	uint32_t missed = (uint32_t)((now - lastFed) / period);
+	log(true, lastFed - upSince, missed);
+	return true;
+}
+
+bool Watchdog::transition(State from, State to) {
+	return state.compare_exchange_strong(from, to);
+}
+
+void Watchdog::log(bool lost, std::chrono::steady_clock::duration duration, uint32_t missed) {
+	std::lock_guard<std::mutex> lock(eventMutex);
+	Event& e = events[eventCount++ % WATCHDOG_EVENTS];
+	e.at = std::chrono::system_clock::now();
+	e.lost = lost;
+	e.duration = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+	e.missed = missed;
+}
+
+std::vector<Watchdog::Event> Watchdog::getEvents() {
+	std::lock_guard<std::mutex> lock(eventMutex);
+	std::vector<Event> v;
+	uint32_t first = eventCount > WATCHDOG_EVENTS ? eventCount - WATCHDOG_EVENTS : 0;
+	for (uint32_t i = first; i < eventCount; i++) {
+		v.push_back(events[i % WATCHDOG_EVENTS]);
+	}
+	return v;
+}
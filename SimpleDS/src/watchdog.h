@@ -0,0 +1,73 @@
+/*----------------------------------------------------------------------------*/
+/* Copyright (c) Creighton 2015. All Rights Reserved.                         */
+/* Open Source Software - May be modified and shared but must                 */
+/* be accompanied by the license file in the root source directory            */
+/*----------------------------------------------------------------------------*/
+
+#ifndef _WATCHDOG_H_
+#define _WATCHDOG_H_
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#define WATCHDOG_EVENTS 64 // Losses and recoveries kept for display and stats
+
+// Decides whether the roboRIO is talking to us. Status should arrive once
+// per control packet, so after threshold periods with none, comms are
+// lost. The control loop feed()s it every status packet and check()s it
+// every period, and is the only thread that changes the state. Anything
+// may read it, and it flips in one step, so nobody sees half a transition.
+class Watchdog {
+	public:
+		enum class State : uint8_t {
+			WAITING, // Nothing heard yet
+			UP,
+			LOST
+		};
+
+		struct Event {
+			std::chrono::system_clock::time_point at;
+			bool lost; // Else it came back
+			int64_t duration; // ms: how long it was up before a loss, or out before a recovery (since starting, the first time)
+			uint32_t missed; // Periods without status when it was declared lost
+		};
+
+		Watchdog(std::chrono::nanoseconds period, uint32_t threshold);
+		void setThreshold(uint32_t threshold);
+		uint32_t getThreshold() { return threshold; }
+
+		// These return true on a transition, which they also log
+		bool feed(std::chrono::steady_clock::time_point now);
+		bool check(std::chrono::steady_clock::time_point now);
+		// Lost right now, e.g. the roboRIO refused the packet
+		bool trip(std::chrono::steady_clock::time_point now);
+
+		State getState() { return state; }
+		bool isUp() { return state == State::UP; }
+		uint32_t getLosses() { return losses; }
+		int64_t getLongestOutage() { return longestOutage; } // ms
+		std::vector<Event> getEvents(); // Oldest first
+
+	private:
+		std::chrono::nanoseconds period;
+		std::atomic<uint32_t> threshold;
+		std::atomic<State> state;
+		std::atomic<uint32_t> losses;
+		std::atomic<int64_t> longestOutage;
+
+		// Control loop only
+		std::chrono::steady_clock::time_point started;
+		std::chrono::steady_clock::time_point lastFed;
+		std::chrono::steady_clock::time_point upSince;
+
+		std::mutex eventMutex; // Only taken on a transition and by getEvents()
+		Event events[WATCHDOG_EVENTS];
+		uint32_t eventCount;
+
+		bool transition(State from, State to);
+		void log(bool lost, std::chrono::steady_clock::duration duration, uint32_t missed);
+};
+
+#endif /* _WATCHDOG_H_ */